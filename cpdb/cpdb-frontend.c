@@ -1,5 +1,8 @@
 #include "cpdb-frontend.h"
 
+typedef struct cpdb_async_listing_s cpdb_async_listing_t;
+typedef struct cpdb_translation_key_s cpdb_translation_key_t;
+
 static void                 on_printer_added                (GDBusConnection *          connection,
                                                              const gchar *              sender_name,
                                                              const gchar *              object_path,
@@ -31,10 +34,77 @@ static void                 on_name_lost                    (GDBusConnection *
 
 static void                 fetchPrinterListFromBackend     (cpdb_frontend_obj_t *      frontend_obj,
                                                              const char *               backend);
+static void                 cpdbUpdatePrinter               (cpdb_frontend_obj_t *      frontend_obj,
+                                                             cpdb_printer_obj_t *       printer_obj,
+                                                             cpdb_printer_obj_t *       live);
+static void                 cpdbAddPrintersFromList         (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               backend,
+                                                             GVariant *                 printers);
                                              
+static guint                cpdbPrinterKeyHash              (gconstpointer              key);
+static gboolean             cpdbPrinterKeyEqual             (gconstpointer              a,
+                                                             gconstpointer              b);
+static cpdb_printer_key_t * cpdbNewPrinterKey               (const cpdb_printer_obj_t * printer_obj);
+
 static void                 cpdbActivateBackends            (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbListBackendNames            (cpdb_async_listing_t *     listing);
+static void                 cpdbFinishConnect               (cpdb_frontend_obj_t *      frontend_obj,
+                                                             gboolean                   status);
+static void                 cpdbFinishPending               (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbSetupBackendProxy           (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               backend_name,
+                                                             PrintBackend *             proxy);
+static GCancellable *       cpdbGetCancellable              (PrintBackend *             proxy);
+static void                 cpdbRecordCall                  (PrintBackend *             proxy,
+                                                             cpdb_backend_method_t      method,
+                                                             const char *               backend_name,
+                                                             gint64                     start,
+                                                             const GError *             error);
+static void                 cpdbReleaseBackendStats         (gpointer                   stats);
+static void                 cpdbActivateBackendAsync        (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               service_name);
+static cpdb_printer_obj_t * cpdbLookupPrinter               (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               printer_id,
+                                                             const char *               backend_name,
+                                                             gboolean                   wait);
+static PrintBackend *       cpdbCreateBackendWithFlags      (GDBusConnection *          connection,
+                                                             const char *               service_name,
+                                                             GDBusProxyFlags            flags);
+static void                 cpdbInstallBackendProxy         (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               backend_name,
+                                                             PrintBackend *             proxy);
+static gboolean             cpdbIsPlaceholderBackend        (PrintBackend *             proxy);
+static void                 cpdbCreatePlaceholderBackend    (cpdb_frontend_obj_t *      frontend_obj,
+                                                             cpdb_async_listing_t *     listing,
+                                                             const char *               backend_name,
+                                                             GPtrArray *                printers);
+static void                 cpdbScheduleWarmup              (cpdb_frontend_obj_t *      frontend_obj);
+
+static void                 cpdbLoadPrinterCache            (cpdb_frontend_obj_t *      frontend_obj,
+                                                             cpdb_async_listing_t *     listing);
+static void                 cpdbAddCachedPrinter            (cpdb_frontend_obj_t *      frontend_obj,
+                                                             cpdb_printer_obj_t *       printer_obj);
+static void                 cpdbSavePrinterCache            (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbPurgeCachedPrinters         (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               backend);
 
 static GList *              cpdbLoadDefaultPrinters         (const char *               path);
+static GList *              cpdbLoadAllDefaultPrinters      ();
+static void                 cpdbStartPrefetch               (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbQueuePrefetch               (cpdb_prefetch_t *          prefetch,
+                                                             cpdb_printer_obj_t *       printer_obj,
+                                                             gboolean                   first);
+static void                 cpdbPumpPrefetch                (cpdb_prefetch_t *          prefetch);
+static void                 cpdbSetPrinterOptions           (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               revision,
+                                                             int                        num_options,
+                                                             GVariant *                 var,
+                                                             int                        num_media,
+                                                             GVariant *                 media_var);
+static void                 cpdbStopPrefetch                (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbCancelPrefetch              (cpdb_frontend_obj_t *      frontend_obj);
+static void                 cpdbClearPrefetch               (gpointer                   prefetch);
+static void                 cpdbRestartPrefetch             (cpdb_frontend_obj_t *      frontend_obj);
 
 static int                  cpdbSetDefaultPrinter           (const char *               path,
                                                              cpdb_printer_obj_t *       printer_obj);
@@ -43,6 +113,42 @@ static void                 cpdbFillBasicOptions            (cpdb_printer_obj_t
                                                              GVariant *                 variant);
 
 static void                 cpdbDeleteTranslations          (cpdb_printer_obj_t *       printer_obj);
+static gboolean             cpdbHasTranslations             (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               locale);
+static char *               cpdbFindTranslation             (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               locale,
+                                                             const cpdb_translation_key_t *
+                                                                                        key,
+                                                             gboolean *                 missing);
+static char *               cpdbFillTranslation             (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               locale,
+                                                             const cpdb_translation_key_t *
+                                                                                        key);
+static void                 cpdbApplyTranslationCacheLimits (cpdb_printer_obj_t *       printer_obj,
+                                                             int                        max_locales,
+                                                             gsize                      max_size);
+static void                 cpdbReleaseOption               (cpdb_option_t *            option);
+static cpdb_media_t **      cpdbGetMediaIndex               (cpdb_options_t *           options,
+                                                             int *                      count);
+static int *                cpdbIndexChoices                (cpdb_arena_t *             arena,
+                                                             char **                    values,
+                                                             int                        num_values);
+static void                 cpdbForgetOptionsRevisions      (cpdb_frontend_obj_t *      frontend_obj,
+                                                             const char *               backend_name);
+static gboolean             cpdbMapCachedOptions            (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               revision,
+                                                             int *                      num_options,
+                                                             GVariant **                var,
+                                                             int *                      num_media,
+                                                             GVariant **                media_var);
+static gboolean             cpdbLoadCachedOptions           (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               revision);
+static void                 cpdbSaveCachedOptions           (cpdb_printer_obj_t *       printer_obj,
+                                                             const char *               revision,
+                                                             int                        num_options,
+                                                             GVariant *                 var,
+                                                             int                        num_media,
+                                                             GVariant *                 media_var);
 
 static void                 cpdbUnpackOptions               (int                        num_options,
                                                              GVariant *                 var,
@@ -74,26 +180,84 @@ cpdb_frontend_obj_t *cpdbGetNewFrontendObj(const char *instance_name,
     else
         f->bus_name = cpdbConcat(CPDB_DIALOG_BUS_NAME, instance_name);
     f->printer_cb = printer_cb;
+    f->activation_mode = CPDB_ACTIVATION_SEQUENTIAL;
+    f->activation_timeout = CPDB_ACTIVATION_TIMEOUT_DEFAULT;
+    f->num_pending = 0;
+    f->connecting = FALSE;
+    f->cancellable = g_cancellable_new();
+    f->connect_cb = NULL;
+    f->connect_user_data = NULL;
+    f->connect_timeout = NULL;
+    f->call_timeout = CPDB_CALL_TIMEOUT_DEFAULT;
+    f->backend_timeouts = g_hash_table_new_full(g_str_hash,
+                                                g_str_equal,
+                                                free,
+                                                NULL);
+    f->lazy_activation = FALSE;
+    f->warmup_timeout = CPDB_WARMUP_TIMEOUT_DEFAULT;
+    f->warmup_source = NULL;
+    f->use_printer_cache = FALSE;
+    f->cached_printers = g_hash_table_new_full(cpdbPrinterKeyHash,
+                                               cpdbPrinterKeyEqual,
+                                               free,
+                                               NULL);
+    f->call_stats = g_hash_table_new_full(g_str_hash,
+                                          g_str_equal,
+                                          free,
+                                          cpdbReleaseBackendStats);
+    g_mutex_init(&f->call_stats_lock);
+    f->prefetch = NULL;
+    f->use_options_cache = FALSE;
+    f->translation_cache_locales = CPDB_TRANSLATION_CACHE_LOCALES;
+    f->translation_cache_size = CPDB_TRANSLATION_CACHE_SIZE;
     f->num_backends = 0;
     f->backend = g_hash_table_new_full(g_str_hash,
                                        g_str_equal,
                                        free,
                                        g_object_unref);
     f->num_printers = 0;
-    f->printer = g_hash_table_new_full(g_str_hash,
-                                       g_str_equal,
+    f->printer = g_hash_table_new_full(cpdbPrinterKeyHash,
+                                       cpdbPrinterKeyEqual,
                                        free,
                                        NULL);
     f->last_saved_settings = cpdbReadSettingsFromDisk();
     return f;
 }
 
+static guint cpdbPrinterKeyHash(gconstpointer key)
+{
+    const cpdb_printer_key_t *k = key;
+
+    return g_str_hash(k->id) * 31 + g_str_hash(k->backend_name);
+}
+
+static gboolean cpdbPrinterKeyEqual(gconstpointer a,
+                                    gconstpointer b)
+{
+    const cpdb_printer_key_t *ka = a, *kb = b;
+
+    /* Backend names of printers are interned */
+    return (ka->backend_name == kb->backend_name ||
+            strcmp(ka->backend_name, kb->backend_name) == 0) &&
+           strcmp(ka->id, kb->id) == 0;
+}
+
+static cpdb_printer_key_t *cpdbNewPrinterKey(const cpdb_printer_obj_t *p)
+{
+    cpdb_printer_key_t *key = g_new(cpdb_printer_key_t, 1);
+
+    key->id = p->id;
+    key->backend_name = p->backend_name;
+    return key;
+}
+
 void cpdbDeleteFrontendObj(cpdb_frontend_obj_t *f)
 {
     if (f == NULL)
         return;
     logdebug("Deleting frontend obj %s\n", f->bus_name);
 
+    cpdbStopPrefetch(f);
     cpdbDisconnectFromDBus(f);
 
     if (f->skeleton)
@@ -106,6 +270,15 @@ void cpdbDeleteFrontendObj(cpdb_frontend_obj_t *f)
         g_hash_table_destroy(f->printer);
     if (f->last_saved_settings)
         cpdbDeleteSettings(f->last_saved_settings);
+    if (f->cancellable)
+        g_object_unref(f->cancellable);
+    if (f->backend_timeouts)
+        g_hash_table_destroy(f->backend_timeouts);
+    if (f->cached_printers)
+        g_hash_table_destroy(f->cached_printers);
+    if (f->call_stats)
+        g_hash_table_destroy(f->call_stats);
+    g_mutex_clear(&f->call_stats_lock);
     
     free(f);
 }
@@ -120,6 +293,7 @@ static void on_printer_added(GDBusConnection *connection,
 {
     cpdb_frontend_obj_t *f = (cpdb_frontend_obj_t *)user_data;
     cpdb_printer_obj_t *p = cpdbGetNewPrinterObj();
+    cpdb_printer_obj_t *known;
     
     /* If some previously saved settings were retrieved, 
      * use them in this new cpdb_printer_obj_t */
@@ -128,7 +302,22 @@ static void on_printer_added(GDBusConnection *connection,
         cpdbCopySettings(f->last_saved_settings, p->settings);
     }
     cpdbFillBasicOptions(p, parameters);
-    cpdbAddPrinter(f, p);
+    cpdbTraceInstant(CPDB_TRACE_SIGNAL, signal_name, p->backend_name, 0);
+    cpdbForgetOptionsRevisions(f, p->backend_name);
+
+    /* Announced again, e.g. by a restarted backend */
+    cpdb_printer_key_t key = { p->id, p->backend_name };
+    if ((known = g_hash_table_lookup(f->printer, &key)) != NULL)
+    {
+        g_hash_table_remove(f->cached_printers, &key);
+        cpdbUpdatePrinter(f, known, p);
+        return;
+    }
+    if (!cpdbAddPrinter(f, p))
+    {
+        cpdbDeletePrinterObj(p);
+        return;
+    }
     f->printer_cb(f, p, CPDB_CHANGE_PRINTER_ADDED);
 }
 
@@ -141,11 +330,15 @@ static void on_printer_removed(GDBusConnection *connection,
                                gpointer user_data)
 {
     cpdb_frontend_obj_t *f = (cpdb_frontend_obj_t *)user_data;
-    char *printer_id;
-    char *backend_name;
-    
-    g_variant_get(parameters, "(ss)", &printer_id, &backend_name);
+    const char *printer_id;
+    const char *backend_name;
+
+    g_variant_get(parameters, "(&s&s)", &printer_id, &backend_name);
+    cpdbTraceInstant(CPDB_TRACE_SIGNAL, signal_name, backend_name, 0);
+    cpdbForgetOptionsRevisions(f, backend_name);
     cpdb_printer_obj_t *p = cpdbRemovePrinter(f, printer_id, backend_name);
+    if (p == NULL)
+        return;
     f->printer_cb(f, p, CPDB_CHANGE_PRINTER_REMOVED);
 }
 
@@ -159,11 +352,19 @@ static void on_printer_state_changed(GDBusConnection *connection,
 {
     cpdb_frontend_obj_t *f = (cpdb_frontend_obj_t *) user_data;
     gboolean printer_is_accepting_jobs;
-    char *printer_id, *printer_state, *backend_name;
+    const char *printer_id, *printer_state, *backend_name;
 
-    g_variant_get(parameters, "(ssbs)", &printer_id, &printer_state,
+    g_variant_get(parameters, "(&s&sb&s)", &printer_id, &printer_state,
                     &printer_is_accepting_jobs, &backend_name);
-    cpdb_printer_obj_t *p = cpdbFindPrinterObj(f, printer_id, backend_name);
+    cpdbTraceInstant(CPDB_TRACE_SIGNAL, signal_name, backend_name, 0);
+    cpdb_printer_key_t key = { printer_id, backend_name };
+    cpdb_printer_obj_t *p = g_hash_table_lookup(f->printer, &key);
+    if (p == NULL)
+    {
+        logdebug("Ignoring state change of unknown printer %s %s\n",
+                 printer_id, backend_name);
+        return;
+    }
     if (p->state)
         free(p->state);
     p->state = cpdbGetStringCopy(printer_state);
@@ -219,11 +420,16 @@ static void on_name_acquired(GDBusConnection *connection,
     if (error)
     {
         logerror("Error exporting frontend interface : %s\n", error->message);
+        g_error_free(error);
+        f->name_done = TRUE;
+        cpdbFinishConnect(f, FALSE);
         return;
     }
     
     cpdbActivateBackends(f);
     f->name_done = TRUE;
+    if (f->num_pending == 0)
+        cpdbFinishConnect(f, TRUE);
 }
 
 static void on_name_lost(GDBusConnection *connection,
@@ -233,6 +439,7 @@ static void on_name_lost(GDBusConnection *connection,
     logdebug("Lost bus name %s\n", name);
     cpdb_frontend_obj_t *f = user_data;
     f->name_done = TRUE;
+    cpdbFinishConnect(f, FALSE);
 }
 
 static GDBusConnection *get_dbus_connection()
@@ -260,15 +467,87 @@ static GDBusConnection *get_dbus_connection()
     return connection;
 }
 
+void cpdbSetActivationMode(cpdb_frontend_obj_t *f,
+                           cpdb_activation_mode_t mode,
+                           int timeout)
+{
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbSetActivationMode()\n");
+        return;
+    }
+
+    f->activation_mode = mode;
+    f->activation_timeout = timeout;
+}
+
+void cpdbSetLazyActivation(cpdb_frontend_obj_t *f,
+                           gboolean lazy,
+                           int warmup_timeout)
+{
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbSetLazyActivation()\n");
+        return;
+    }
+
+    f->lazy_activation = lazy;
+    f->warmup_timeout = warmup_timeout;
+}
+
+static gboolean warmup_timeout_cb(gpointer user_data)
+{
+    char *service_name;
+    gpointer key, value;
+    GHashTableIter iter;
+    cpdb_frontend_obj_t *f = user_data;
+
+    logdebug("Starting the lazily registered backends\n");
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        if (!cpdbIsPlaceholderBackend(value))
+            continue;
+        service_name = cpdbConcat(CPDB_BACKEND_PREFIX, key);
+        cpdbActivateBackendAsync(f, service_name);
+        free(service_name);
+    }
+
+    g_source_unref(f->warmup_source);
+    f->warmup_source = NULL;
+    return G_SOURCE_REMOVE;
+}
+
+static void cpdbScheduleWarmup(cpdb_frontend_obj_t *f)
+{
+    if (!f->lazy_activation || f->warmup_timeout < 0 || f->warmup_source)
+        return;
+
+    f->warmup_source = g_timeout_source_new(f->warmup_timeout);
+    g_source_set_callback(f->warmup_source, warmup_timeout_cb, f, NULL);
+    g_source_attach(f->warmup_source, g_main_context_get_thread_default());
+}
+
+static gboolean activation_timeout_cb(gpointer user_data)
+{
+    gboolean *timed_out = user_data;
+
+    *timed_out = TRUE;
+    return G_SOURCE_REMOVE;
+}
+
 void cpdbConnectToDBus(cpdb_frontend_obj_t *f)
 {
     GMainContext *context;
+    GSource *timeout = NULL;
+    gboolean timed_out = FALSE;
 
     if ((f->connection = get_dbus_connection()) == NULL)
     {
         loginfo("Couldn't connect to DBus\n");
         return;
     }
+    cpdbRestartPrefetch(f);
     
     f->own_id = g_bus_own_name_on_connection(f->connection,
                                              f->bus_name,
@@ -279,277 +558,2283 @@ void cpdbConnectToDBus(cpdb_frontend_obj_t *f)
                                              NULL);
 
     // Wait till either of name acquired/lost callbacks finish
+    // and, in parallel mode, till the backends have answered
     context = g_main_context_ref_thread_default();
-    while (!f->name_done)
+    if (f->activation_mode == CPDB_ACTIVATION_PARALLEL && f->activation_timeout >= 0)
+    {
+        timeout = g_timeout_source_new(f->activation_timeout);
+        g_source_set_callback(timeout, activation_timeout_cb, &timed_out, NULL);
+        g_source_attach(timeout, context);
+    }
+
+    f->connecting = TRUE;
+    while (!f->name_done || (f->num_pending > 0 && !timed_out))
     {
         g_main_context_iteration(context, TRUE);
     }
+    f->connecting = FALSE;
+
+    if (f->num_pending > 0)
+        logwarn("Timed out waiting for %d backends\n", f->num_pending);
+    if (timeout)
+    {
+        g_source_destroy(timeout);
+        g_source_unref(timeout);
+    }
     g_main_context_unref(context);
-}
 
-void cpdbDisconnectFromDBus(cpdb_frontend_obj_t *f)
-{
-    if (f->connection == NULL || g_dbus_connection_is_closed(f->connection))
+    if (f->own_id != 0)
     {
-        logwarn("Already disconnected from DBus\n");
-        return;
+        cpdbScheduleWarmup(f);
+        cpdbStartPrefetch(f);
     }
-    
-    print_frontend_emit_stop_listing(f->skeleton);
-    g_dbus_connection_flush_sync(f->connection, NULL, NULL);
-    
-    g_bus_unown_name(f->own_id);
-    g_dbus_connection_close_sync(f->connection, NULL, NULL);
 }
 
-static void fetchPrinterListFromBackend(cpdb_frontend_obj_t *f, const char *backend)
+static GCancellable *cpdbGetCancellable(PrintBackend *proxy)
 {
-    int num_printers;
-    GVariantIter iter;
-    GVariant *printers, *printer;
-    PrintBackend *proxy;
-    GError *error = NULL;
-    cpdb_printer_obj_t *p;
+    if (proxy == NULL)
+        return NULL;
+    return g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_CANCELLABLE);
+}
 
-    if ((proxy = g_hash_table_lookup(f->backend, backend)) == NULL)
-    {
-        logerror("Couldn't get %s proxy object\n", backend);
+/**
+ * Call statistics of a backend, shared by the frontend
+ * and the backend proxies so that printers can update them
+ */
+typedef struct {
+    GMutex lock;
+    cpdb_call_stats_t methods[CPDB_NUM_METHODS];
+} cpdb_backend_stats_t;
+
+static const char *cpdb_method_names[CPDB_NUM_METHODS] = {
+    "GetPrinterList",
+    "GetDefaultPrinter",
+    "GetAllOptions",
+    "GetAllOptionsBatch",
+    "GetOptionsRevisions",
+    "GetAllTranslations",
+    "GetOptionTranslation",
+    "GetChoiceTranslation",
+    "GetGroupTranslation",
+    "GetPrinterState",
+    "IsAcceptingJobs",
+    "GetActiveJobsCount",
+    "GetAllJobs",
+    "PrintFile",
+    "CancelJob",
+    "KeepAlive",
+    "Replace",
+};
+
+static void cpdbClearBackendStats(gpointer data)
+{
+    cpdb_backend_stats_t *stats = data;
+
+    g_mutex_clear(&stats->lock);
+}
+
+static void cpdbReleaseBackendStats(gpointer stats)
+{
+    g_rc_box_release_full(stats, cpdbClearBackendStats);
+}
+
+static void cpdbRecordCall(PrintBackend *proxy,
+                           cpdb_backend_method_t method,
+                           const char *backend_name,
+                           gint64 start,
+                           const GError *error)
+{
+    int bucket;
+    gint64 elapsed = g_get_monotonic_time() - start;
+    cpdb_call_stats_t *s;
+    cpdb_backend_stats_t *stats = NULL;
+
+    cpdbTraceComplete(CPDB_TRACE_BACKEND_CALL, cpdb_method_names[method],
+                      backend_name, start, error ? error->code : 0, 0);
+
+    /* Not set up by a frontend, like resurrected printers' */
+    if (proxy != NULL)
+        stats = g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_CALL_STATS);
+    if (stats == NULL)
         return;
-    }
-    print_backend_call_get_printer_list_sync (proxy, &num_printers,
-                                                &printers, NULL, &error);
+
+    bucket = elapsed > 1 ? g_bit_storage(elapsed) - 1 : 0;
+    bucket = MIN(bucket, CPDB_LATENCY_BUCKETS - 1);
+
+    g_mutex_lock(&stats->lock);
+    s = &stats->methods[method];
+    s->num_calls++;
     if (error)
     {
-        logerror("Error getting %s printer list : %s\n", backend, error->message);
-        return;
+        s->num_errors++;
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_TIMED_OUT))
+            s->num_timeouts++;
     }
-    logdebug("Fetched %d printers from backend %s\n", num_printers, backend);
-    g_variant_iter_init(&iter, printers);
-    while (g_variant_iter_loop(&iter, "(v)", &printer))
+    s->total_time += elapsed;
+    s->max_time = MAX(s->max_time, elapsed);
+    s->histogram[bucket]++;
+    g_mutex_unlock(&stats->lock);
+}
+
+static void cpdbSetupBackendProxy(cpdb_frontend_obj_t *f,
+                                  const char *backend_name,
+                                  PrintBackend *proxy)
+{
+    int timeout = f->call_timeout;
+    gpointer value;
+    cpdb_backend_stats_t *stats;
+
+    if (g_hash_table_lookup_extended(f->backend_timeouts, backend_name, NULL, &value))
+        timeout = GPOINTER_TO_INT(value);
+    g_dbus_proxy_set_default_timeout(G_DBUS_PROXY(proxy), timeout);
+
+    /* Printers only know their backend proxy, so that is
+     * how the frontend's cancellable reaches their calls */
+    g_object_set_data_full(G_OBJECT(proxy), CPDB_PROXY_CANCELLABLE,
+                           g_object_ref(f->cancellable), g_object_unref);
+
+    /* Kept by backend name, so they survive replacing the proxy */
+    g_mutex_lock(&f->call_stats_lock);
+    if ((stats = g_hash_table_lookup(f->call_stats, backend_name)) == NULL)
     {
-        p = cpdbGetNewPrinterObj();
-        cpdbFillBasicOptions(p, printer);
-        if (f->last_saved_settings != NULL)
-            cpdbCopySettings(f->last_saved_settings, p->settings);
-        cpdbAddPrinter(f, p);
+        stats = g_rc_box_new0(cpdb_backend_stats_t);
+        g_mutex_init(&stats->lock);
+        g_hash_table_insert(f->call_stats, cpdbGetStringCopy(backend_name), stats);
     }
+    g_object_set_data_full(G_OBJECT(proxy), CPDB_PROXY_CALL_STATS,
+                           g_rc_box_acquire(stats), cpdbReleaseBackendStats);
+    g_mutex_unlock(&f->call_stats_lock);
+    g_object_set_data(G_OBJECT(proxy), CPDB_PROXY_OPTIONS_CACHE,
+                      GINT_TO_POINTER(f->use_options_cache));
 }
 
-static void cpdbActivateBackends(cpdb_frontend_obj_t *f)
+void cpdbSetCallTimeout(cpdb_frontend_obj_t *f,
+                        int timeout)
 {
-    int len, i;
-    char *service_name, *backend_suffix;
-    GDBusProxy *dbus_proxy;
-    PrintBackend *backend_proxy;
-    GVariantIter iter;
-    GError *error = NULL;
-    GVariant *service_names, *service_names_tuple;
-    const char * const name_lists[] =
-    {
-      "ListNames",
-      "ListActivatableNames",
-      NULL
-    };
+    gpointer key, value;
+    GHashTableIter iter;
 
-    logdebug("Activating backends\n");
-    dbus_proxy = g_dbus_proxy_new_sync(f->connection,
-                                       G_DBUS_PROXY_FLAGS_NONE,
-                                       NULL,
-                                       "org.freedesktop.DBus",
-                                       "/org/freedesktop/DBus",
-                                       "org.freedesktop.DBus",
-                                       NULL,
-                                       &error);
-    if (error)
+    if (f == NULL)
     {
-        logerror("Error getting dbus proxy : %s", error->message);
-        g_error_free(error);
+        logwarn("Invalid params: cpdbSetCallTimeout()\n");
         return;
     }
 
-    for (i = 0; name_lists[i]; i ++)
-    {
-      service_names_tuple = g_dbus_proxy_call_sync(dbus_proxy,
-						   name_lists[i],
-						   NULL,
-						   G_DBUS_CALL_FLAGS_NONE,
-						   -1,
-						   NULL,
-						   &error);
-      if (error)
-      {
-	logerror("Couldn't get service names (%s): %s",
-		 name_lists[i], error->message);
-	g_error_free(error);
-	continue;
-      }
-
-      service_names = g_variant_get_child_value(service_names_tuple, 0);
-
-      len = strlen(CPDB_BACKEND_PREFIX);
-      g_variant_iter_init(&iter, service_names);
-      while (g_variant_iter_next(&iter, "s", &service_name))
-      {
-        if (g_str_has_prefix(service_name, CPDB_BACKEND_PREFIX))
-	{
-	  backend_suffix = cpdbGetStringCopy(service_name + len);
-	  if (g_hash_table_lookup(f->backend, backend_suffix))
-	    continue;
-	  loginfo("Found backend %s (%s)\n", backend_suffix,
-		  i ? "Starting now" : "Already running");
-	  backend_proxy = cpdbCreateBackend(f->connection, service_name);
-	  if (backend_proxy == NULL)
-	    continue;
-	  g_hash_table_insert(f->backend, backend_suffix, backend_proxy);
-	  f->num_backends++;
-	  fetchPrinterListFromBackend(f, backend_suffix);
-	  g_object_unref(backend_proxy);
-        }
-      }
-
-      g_variant_unref(service_names);
-      g_variant_unref(service_names_tuple);
-    }
+    f->call_timeout = timeout;
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        cpdbSetupBackendProxy(f, key, value);
 }
 
-PrintBackend *cpdbCreateBackend(GDBusConnection *connection,
-                                const char *service_name)
+void cpdbSetBackendCallTimeout(cpdb_frontend_obj_t *f,
+                               const char *backend_name,
+                               int timeout)
 {
-    FILE *file = NULL;
     PrintBackend *proxy;
-    GError *error = NULL;
-    char *path, *backend_name;
-    const char *info_dir_name;
-    char obj_path[CPDB_BSIZE];
-    
-    backend_name = cpdbGetStringCopy(service_name);
-    proxy = print_backend_proxy_new_sync(connection,
-                                         0,
-                                         backend_name,
-                                         CPDB_BACKEND_OBJ_PATH,
-                                         NULL,
-                                         &error);
-    if (error)
+
+    if (f == NULL || backend_name == NULL)
     {
-        logerror("Error creating backend proxy for %s : %s\n",
-                    backend_name, error->message);
-        return NULL;
+        logwarn("Invalid params: cpdbSetBackendCallTimeout()\n");
+        return;
     }
-    return proxy;
-}
 
-void cpdbIgnoreLastSavedSettings(cpdb_frontend_obj_t *f)
-{
-    loginfo("Ignoring previous settings\n");
-    cpdbDeleteSettings(f->last_saved_settings);
-    f->last_saved_settings = cpdbGetNewSettings();
+    g_hash_table_insert(f->backend_timeouts, cpdbGetStringCopy(backend_name),
+                        GINT_TO_POINTER(timeout));
+    if ((proxy = g_hash_table_lookup(f->backend, backend_name)) != NULL)
+        cpdbSetupBackendProxy(f, backend_name, proxy);
 }
 
-gboolean cpdbAddPrinter(cpdb_frontend_obj_t *f, 
-                        cpdb_printer_obj_t *p)
+void cpdbCancelPendingCalls(cpdb_frontend_obj_t *f)
 {
-    p->backend_proxy = g_hash_table_lookup(f->backend, p->backend_name);
-    if (p->backend_proxy == NULL)
+    gpointer key, value;
+    GHashTableIter iter;
+
+    if (f == NULL)
     {
-        logerror("Couldn't add printer %s : Backend doesn't exist %s\n",
-                    p->id, p->backend_name);
-        return FALSE;
+        logwarn("Invalid params: cpdbCancelPendingCalls()\n");
+        return;
     }
-    g_object_ref(p->backend_proxy);
 
-    loginfo("Adding printer %s %s\n", p->id, p->backend_name);
-    cpdbDebugPrinter(p);
-    g_hash_table_insert(f->printer, cpdbConcatSep(p->id, p->backend_name), p);
-    f->num_printers++;
+    /* The callbacks of cancelled calls don't touch the frontend anymore */
+    logdebug("Cancelling pending calls\n");
+    g_cancellable_cancel(f->cancellable);
+    g_object_unref(f->cancellable);
+    f->cancellable = g_cancellable_new();
 
-    return TRUE;
-}
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+        cpdbSetupBackendProxy(f, key, value);
 
-cpdb_printer_obj_t *cpdbRemovePrinter(cpdb_frontend_obj_t *f,
-                                      const char *printer_id,
-                                      const char *backend_name)
-{
-    char *key;
-    cpdb_printer_obj_t *p = NULL;
+    cpdbCancelPrefetch(f);
 
-    loginfo("Removing printer %s %s\n", printer_id, backend_name);
-    key = cpdbConcatSep(printer_id, backend_name);
-    if (g_hash_table_contains(f->printer, key))
-    {
-        p = cpdbFindPrinterObj(f, printer_id, backend_name);
-        g_hash_table_remove(f->printer, key);
-        f->num_printers--;
-    }
-    else
+    f->num_pending = 0;
+    cpdbFinishConnect(f, FALSE);
+
+    if (f->warmup_source)
     {
-        logwarn("Printer %s %s not found\n", printer_id, backend_name);
+        g_source_destroy(f->warmup_source);
+        g_source_unref(f->warmup_source);
+        f->warmup_source = NULL;
     }
-    
-    free(key);
-    return p;
 }
 
-void cpdbHideRemotePrinters(cpdb_frontend_obj_t *f)
+const char *cpdbGetBackendMethodName(cpdb_backend_method_t method)
 {
-    loginfo("Hiding remote printers\n");
-    print_frontend_emit_hide_remote_printers(f->skeleton);
+    if (method < 0 || method >= CPDB_NUM_METHODS)
+        return NULL;
+    return cpdb_method_names[method];
 }
 
-void cpdbUnhideRemotePrinters(cpdb_frontend_obj_t *f)
+gboolean cpdbGetCallStats(cpdb_frontend_obj_t *f,
+                          const char *backend_name,
+                          cpdb_backend_method_t method,
+                          cpdb_call_stats_t *s)
 {
-    loginfo("Unhiding remote printers\n");
-    print_frontend_emit_unhide_remote_printers(f->skeleton);
-}
+    cpdb_backend_stats_t *stats;
 
-void cpdbHideTemporaryPrinters(cpdb_frontend_obj_t *f)
-{
-    loginfo("Hiding temporary printers\n");
-    print_frontend_emit_hide_temporary_printers(f->skeleton);
+    if (f == NULL || backend_name == NULL || s == NULL ||
+        method < 0 || method >= CPDB_NUM_METHODS)
+    {
+        logwarn("Invalid params: cpdbGetCallStats()\n");
+        return FALSE;
+    }
+
+    g_mutex_lock(&f->call_stats_lock);
+    if ((stats = g_hash_table_lookup(f->call_stats, backend_name)) != NULL)
+    {
+        g_mutex_lock(&stats->lock);
+        *s = stats->methods[method];
+        g_mutex_unlock(&stats->lock);
+    }
+    g_mutex_unlock(&f->call_stats_lock);
+    return stats != NULL;
 }
 
-void cpdbUnhideTemporaryPrinters(cpdb_frontend_obj_t *f)
+gint64 cpdbGetCallLatencyPercentile(const cpdb_call_stats_t *s,
+                                    double percentile)
 {
-    loginfo("Unhiding temporary printers\n");
-    print_frontend_emit_unhide_temporary_printers(f->skeleton);
+    int i;
+    guint count = 0;
+    double rank;
+
+    if (s == NULL || s->num_calls == 0)
+        return 0;
+
+    rank = s->num_calls * CLAMP(percentile, 0, 100) / 100;
+    for (i = 0; i < CPDB_LATENCY_BUCKETS - 1; i++)
+    {
+        count += s->histogram[i];
+        if (count >= rank && count > 0)
+            return MIN((gint64) 2 << i, s->max_time);
+    }
+    return s->max_time;
 }
 
-cpdb_printer_obj_t *cpdbFindPrinterObj(cpdb_frontend_obj_t *f,
-                                       const char *printer_id,
-                                       const char *backend_name)
+void cpdbResetCallStats(cpdb_frontend_obj_t *f)
 {
-    char *hashtable_key;
-    cpdb_printer_obj_t *p;
+    gpointer value;
+    GHashTableIter iter;
+    cpdb_backend_stats_t *stats;
 
-    if (printer_id == NULL || backend_name == NULL)
+    if (f == NULL)
     {
-        logwarn("Invalid parameters: cpdbFindPrinterObj()\n");
-        return NULL;
+        logwarn("Invalid params: cpdbResetCallStats()\n");
+        return;
     }
 
-    hashtable_key = cpdbConcatSep(printer_id, backend_name);
-    p = g_hash_table_lookup(f->printer, hashtable_key);
-    if (p == NULL)
+    g_mutex_lock(&f->call_stats_lock);
+    g_hash_table_iter_init(&iter, f->call_stats);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
     {
-        logwarn("Couldn't find printer %s %s : Doesn't exist\n",
-                printer_id, backend_name);
+        stats = value;
+        g_mutex_lock(&stats->lock);
+        memset(stats->methods, 0, sizeof(stats->methods));
+        g_mutex_unlock(&stats->lock);
     }
-
-    free(hashtable_key);
-    return p;
+    g_mutex_unlock(&f->call_stats_lock);
 }
 
-cpdb_printer_obj_t *cpdbGetDefaultPrinterForBackend(cpdb_frontend_obj_t *f,
-                                                    const char *backend_name)
+void cpdbPrintCallStats(cpdb_frontend_obj_t *f,
+                        FILE *out)
 {
-    char *def, *service_name;
-    GError *error = NULL;
-    PrintBackend *proxy;
-    cpdb_printer_obj_t *p = NULL;
-    
-    proxy = g_hash_table_lookup(f->backend, backend_name);
-    if (proxy == NULL)
-    {
-        logwarn("Couldn't find backend proxy for %s\n", backend_name);
+    int i;
+    gpointer key, value;
+    GHashTableIter iter;
+    cpdb_call_stats_t s;
+    cpdb_backend_stats_t *stats;
+
+    if (f == NULL || out == NULL)
+    {
+        logwarn("Invalid params: cpdbPrintCallStats()\n");
+        return;
+    }
+
+    /* Backends may be added by the main loop while printing */
+    g_mutex_lock(&f->call_stats_lock);
+    g_hash_table_iter_init(&iter, f->call_stats);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        stats = value;
+        fprintf(out, "Backend %s\n", (char *) key);
+        fprintf(out, "  %-22s %7s %7s %8s %9s %9s %9s %9s\n", "method", "calls",
+                "errors", "timeouts", "avg (ms)", "p50 (ms)", "p95 (ms)", "max (ms)");
+        for (i = 0; i < CPDB_NUM_METHODS; i++)
+        {
+            g_mutex_lock(&stats->lock);
+            s = stats->methods[i];
+            g_mutex_unlock(&stats->lock);
+            if (s.num_calls == 0)
+                continue;
+            fprintf(out, "  %-22s %7u %7u %8u %9.1f %9.1f %9.1f %9.1f\n",
+                    cpdb_method_names[i], s.num_calls, s.num_errors, s.num_timeouts,
+                    s.total_time / 1000.0 / s.num_calls,
+                    cpdbGetCallLatencyPercentile(&s, 50) / 1000.0,
+                    cpdbGetCallLatencyPercentile(&s, 95) / 1000.0,
+                    s.max_time / 1000.0);
+        }
+    }
+    g_mutex_unlock(&f->call_stats_lock);
+}
+
+static void cpdbFinishConnect(cpdb_frontend_obj_t *f, gboolean status)
+{
+    cpdb_connect_callback connect_cb = f->connect_cb;
+
+    if (f->connect_timeout)
+    {
+        g_source_destroy(f->connect_timeout);
+        g_source_unref(f->connect_timeout);
+        f->connect_timeout = NULL;
+    }
+    if (connect_cb == NULL)
+        return;
+
+    if (!status)
+        logwarn("Connected to DBus with %d backends still pending\n", f->num_pending);
+    else
+        loginfo("Connected to DBus, found %d printers\n", f->num_printers);
+    f->connect_cb = NULL;
+    cpdbScheduleWarmup(f);
+    cpdbStartPrefetch(f);
+    connect_cb(f, status, f->connect_user_data);
+}
+
+static gboolean connect_timeout_cb(gpointer user_data)
+{
+    cpdbFinishConnect(user_data, FALSE);
+    return G_SOURCE_REMOVE;
+}
+
+static void connection_ready_cb(GObject *source_object,
+                                GAsyncResult *res,
+                                gpointer user_data)
+{
+    GError *error = NULL;
+    GDBusConnection *connection;
+    cpdb_frontend_obj_t *f = user_data;
+
+    connection = g_dbus_connection_new_for_address_finish(res, &error);
+    if (error)
+    {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            /* The frontend might be gone already */
+            g_error_free(error);
+            return;
+        }
+        logerror("Error acquiring bus connection : %s\n", error->message);
+        g_error_free(error);
+        cpdbFinishConnect(f, FALSE);
+        return;
+    }
+    logdebug("Acquired bus connection\n");
+
+    f->connection = connection;
+    f->own_id = g_bus_own_name_on_connection(f->connection,
+                                             f->bus_name,
+                                             0,
+                                             on_name_acquired,
+                                             on_name_lost,
+                                             f,
+                                             NULL);
+}
+
+void cpdbConnectToDBusAsync(cpdb_frontend_obj_t *f,
+                            cpdb_connect_callback connect_cb,
+                            void *user_data)
+{
+    gchar *bus_addr;
+    GError *error = NULL;
+
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbConnectToDBusAsync()\n");
+        return;
+    }
+
+    f->activation_mode = CPDB_ACTIVATION_PARALLEL;
+    f->name_done = FALSE;
+    f->connect_cb = connect_cb;
+    cpdbRestartPrefetch(f);
+    f->connect_user_data = user_data;
+    if (f->activation_timeout >= 0)
+    {
+        f->connect_timeout = g_timeout_source_new(f->activation_timeout);
+        g_source_set_callback(f->connect_timeout, connect_timeout_cb, f, NULL);
+        g_source_attach(f->connect_timeout, g_main_context_get_thread_default());
+    }
+
+    bus_addr = g_dbus_address_get_for_bus_sync(G_BUS_TYPE_SESSION,
+                                               NULL,
+                                               &error);
+    if (error)
+    {
+        logerror("Error getting bus address : %s\n", error->message);
+        g_error_free(error);
+        cpdbFinishConnect(f, FALSE);
+        return;
+    }
+
+    g_dbus_connection_new_for_address(bus_addr,
+                                      G_DBUS_CONNECTION_FLAGS_AUTHENTICATION_CLIENT |
+                                      G_DBUS_CONNECTION_FLAGS_MESSAGE_BUS_CONNECTION,
+                                      NULL,
+                                      f->cancellable,
+                                      connection_ready_cb,
+                                      f);
+    g_free(bus_addr);
+}
+
+void cpdbDisconnectFromDBus(cpdb_frontend_obj_t *f)
+{
+    f->connect_cb = NULL;
+    cpdbCancelPendingCalls(f);
+
+    if (f->connection == NULL || g_dbus_connection_is_closed(f->connection))
+    {
+        logwarn("Already disconnected from DBus\n");
+        return;
+    }
+
+    if (f->use_printer_cache)
+        cpdbSavePrinterCache(f);
+
+    print_frontend_emit_stop_listing(f->skeleton);
+    g_dbus_connection_flush_sync(f->connection, NULL, NULL);
+    
+    g_bus_unown_name(f->own_id);
+    g_dbus_connection_close_sync(f->connection, NULL, NULL);
+}
+
+static void fetchPrinterListFromBackend(cpdb_frontend_obj_t *f, const char *backend)
+{
+    int num_printers;
+    GVariant *printers;
+    PrintBackend *proxy;
+    GError *error = NULL;
+    gint64 start;
+
+    if ((proxy = g_hash_table_lookup(f->backend, backend)) == NULL)
+    {
+        logerror("Couldn't get %s proxy object\n", backend);
+        return;
+    }
+    start = g_get_monotonic_time();
+    print_backend_call_get_printer_list_sync (proxy, &num_printers,
+                                                &printers, f->cancellable, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_PRINTER_LIST, backend, start, error);
+    if (error)
+    {
+        logerror("Error getting %s printer list : %s\n", backend, error->message);
+        return;
+    }
+    logdebug("Fetched %d printers from backend %s\n", num_printers, backend);
+    cpdbAddPrintersFromList(f, backend, printers);
+    g_variant_unref(printers);
+}
+
+static gboolean cpdbMoveString(char **dest, char **src)
+{
+    gboolean changed = g_strcmp0(*dest, *src) != 0;
+
+    free(*dest);
+    *dest = *src;
+    *src = NULL;
+    return changed;
+}
+
+/**
+ * Update a known printer from a new object for it, which is deleted.
+ */
+static void cpdbUpdatePrinter(cpdb_frontend_obj_t *f,
+                              cpdb_printer_obj_t *p,
+                              cpdb_printer_obj_t *live)
+{
+    gboolean changed = FALSE;
+
+    changed |= cpdbMoveString(&p->name, &live->name);
+    changed |= cpdbMoveString(&p->info, &live->info);
+    changed |= cpdbMoveString(&p->location, &live->location);
+    changed |= cpdbMoveString(&p->make_and_model, &live->make_and_model);
+    changed |= cpdbMoveString(&p->state, &live->state);
+    changed |= p->accepting_jobs != live->accepting_jobs;
+    p->accepting_jobs = live->accepting_jobs;
+
+    free(live->id);
+    cpdbDeletePrinterObj(live);
+
+    if (changed && !f->connecting)
+        f->printer_cb(f, p, CPDB_CHANGE_PRINTER_STATE_CHANGED);
+}
+
+static void cpdbAddPrintersFromList(cpdb_frontend_obj_t *f,
+                                    const char *backend,
+                                    GVariant *printers)
+{
+    GVariantIter iter;
+    GVariant *printer;
+    cpdb_printer_key_t key;
+    cpdb_printer_obj_t *p, *known;
+
+    g_variant_iter_init(&iter, printers);
+    while (g_variant_iter_loop(&iter, "(v)", &printer))
+    {
+        p = cpdbGetNewPrinterObj();
+        cpdbFillBasicOptions(p, printer);
+
+        /* Printers already known, e.g. from the cache, keep their object */
+        key.id = p->id;
+        key.backend_name = p->backend_name;
+        if ((known = g_hash_table_lookup(f->printer, &key)) != NULL)
+        {
+            g_hash_table_remove(f->cached_printers, &key);
+            cpdbUpdatePrinter(f, known, p);
+            continue;
+        }
+
+        if (f->last_saved_settings != NULL)
+            cpdbCopySettings(f->last_saved_settings, p->settings);
+        if (!cpdbAddPrinter(f, p))
+        {
+            cpdbDeletePrinterObj(p);
+            continue;
+        }
+
+        /* Printers arriving after cpdbConnectToDBus() returned
+         * are reported like the ones added later by the backend */
+        if (!f->connecting)
+            f->printer_cb(f, p, CPDB_CHANGE_PRINTER_ADDED);
+    }
+
+    /* Whatever the backend didn't report anymore is gone */
+    cpdbPurgeCachedPrinters(f, backend);
+}
+
+static void cpdbPurgeCachedPrinters(cpdb_frontend_obj_t *f,
+                                    const char *backend)
+{
+    gpointer value;
+    GHashTableIter iter;
+    cpdb_printer_obj_t *p;
+
+    g_hash_table_iter_init(&iter, f->cached_printers);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        p = value;
+        if (strcmp(p->backend_name, backend) != 0)
+            continue;
+        g_hash_table_iter_remove(&iter);
+
+        logdebug("Cached printer %s %s is gone\n", p->id, p->backend_name);
+        cpdbRemovePrinter(f, p->id, p->backend_name);
+        if (f->connecting)
+            cpdbDeletePrinterObj(p);
+        else
+            f->printer_cb(f, p, CPDB_CHANGE_PRINTER_REMOVED);
+    }
+}
+
+static void cpdbAddCachedPrinter(cpdb_frontend_obj_t *f,
+                                 cpdb_printer_obj_t *p)
+{
+    if (f->last_saved_settings != NULL)
+        cpdbCopySettings(f->last_saved_settings, p->settings);
+    if (!cpdbAddPrinter(f, p))
+    {
+        cpdbDeletePrinterObj(p);
+        return;
+    }
+    g_hash_table_insert(f->cached_printers, cpdbNewPrinterKey(p), p);
+
+    if (!f->connecting)
+        f->printer_cb(f, p, CPDB_CHANGE_PRINTER_ADDED);
+}
+
+static void cpdbLoadPrinterCache(cpdb_frontend_obj_t *f,
+                                 cpdb_async_listing_t *l)
+{
+    int num_loaded = 0;
+    gsize length;
+    guint32 version;
+    gpointer key, value;
+    GVariantIter iter;
+    GHashTableIter placeholder_iter;
+    GHashTable *placeholders;
+    GPtrArray *waiting;
+    GError *error = NULL;
+    cpdb_printer_obj_t *p;
+    GVariant *cache, *printers, *printer;
+    char *conf_dir, *path, *contents;
+
+    if ((conf_dir = cpdbGetUserConfDir()) == NULL)
+    {
+        logerror("Error loading printer cache : Couldn't obtain user config dir\n");
+        return;
+    }
+    path = cpdbConcatPath(conf_dir, CPDB_PRINTER_CACHE_FILE);
+    free(conf_dir);
+
+    if (!g_file_get_contents(path, &contents, &length, &error))
+    {
+        loginfo("No printer cache found : %s\n", error->message);
+        g_error_free(error);
+        free(path);
+        return;
+    }
+    cache = g_variant_new_from_data(G_VARIANT_TYPE("(ua(v))"), contents, length,
+                                    FALSE, g_free, contents);
+    g_variant_get(cache, "(u@a(v))", &version, &printers);
+    if (version != CPDB_PRINTER_CACHE_VERSION)
+    {
+        loginfo("Ignoring printer cache %s : Version %u\n", path, version);
+        g_variant_unref(printers);
+        g_variant_unref(cache);
+        free(path);
+        return;
+    }
+
+    /* [backend name] --> printers waiting for the placeholder of their backend */
+    placeholders = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    g_variant_iter_init(&iter, printers);
+    while (g_variant_iter_loop(&iter, "(v)", &printer))
+    {
+        if (!g_variant_is_of_type(printer, G_VARIANT_TYPE(CPDB_PRINTER_ADDED_ARGS)))
+            continue;
+
+        p = cpdbGetNewPrinterObj();
+        cpdbFillBasicOptions(p, printer);
+        num_loaded++;
+        if (g_hash_table_contains(f->backend, p->backend_name))
+        {
+            cpdbAddCachedPrinter(f, p);
+            continue;
+        }
+
+        /* The backend is registered for real once it gets activated */
+        if ((waiting = g_hash_table_lookup(placeholders, p->backend_name)) == NULL)
+        {
+            waiting = g_ptr_array_new();
+            g_hash_table_insert(placeholders, cpdbGetStringCopy(p->backend_name), waiting);
+        }
+        g_ptr_array_add(waiting, p);
+    }
+    loginfo("Loaded %d printers from cache %s\n", num_loaded, path);
+
+    g_hash_table_iter_init(&placeholder_iter, placeholders);
+    while (g_hash_table_iter_next(&placeholder_iter, &key, &value))
+        cpdbCreatePlaceholderBackend(f, l, key, value);
+    g_hash_table_destroy(placeholders);
+
+    g_variant_unref(printers);
+    g_variant_unref(cache);
+    free(path);
+}
+
+static void cpdbSavePrinterCache(cpdb_frontend_obj_t *f)
+{
+    gpointer value;
+    GHashTableIter iter;
+    GError *error = NULL;
+    GVariantBuilder builder;
+    GVariant *cache;
+    cpdb_printer_obj_t *p;
+    char *conf_dir, *path;
+
+    if ((conf_dir = cpdbGetUserConfDir()) == NULL)
+    {
+        logerror("Error saving printer cache : Couldn't obtain user config dir\n");
+        return;
+    }
+    path = cpdbConcatPath(conf_dir, CPDB_PRINTER_CACHE_FILE);
+    free(conf_dir);
+
+    g_variant_builder_init(&builder, G_VARIANT_TYPE("a(v)"));
+    g_hash_table_iter_init(&iter, f->printer);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        p = value;
+        g_variant_builder_add(&builder, "(v)",
+                              g_variant_new(CPDB_PRINTER_ADDED_ARGS,
+                                            p->id,
+                                            p->name ? p->name : "",
+                                            p->info ? p->info : "",
+                                            p->location ? p->location : "",
+                                            p->make_and_model ? p->make_and_model : "",
+                                            p->accepting_jobs,
+                                            p->state ? p->state : "",
+                                            p->backend_name));
+    }
+    cache = g_variant_ref_sink(g_variant_new("(ua(v))", CPDB_PRINTER_CACHE_VERSION, &builder));
+
+    if (!g_file_set_contents(path, g_variant_get_data(cache), g_variant_get_size(cache), &error))
+    {
+        logerror("Error saving printer cache : %s\n", error->message);
+        g_error_free(error);
+    }
+    else
+    {
+        loginfo("Saved %d printers to cache %s\n", f->num_printers, path);
+    }
+
+    g_variant_unref(cache);
+    free(path);
+}
+
+void cpdbUsePrinterCache(cpdb_frontend_obj_t *f,
+                         gboolean use)
+{
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbUsePrinterCache()\n");
+        return;
+    }
+
+    f->use_printer_cache = use;
+}
+
+void cpdbUseOptionsCache(cpdb_frontend_obj_t *f,
+                         gboolean use)
+{
+    gpointer value;
+    GHashTableIter iter;
+
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbUseOptionsCache()\n");
+        return;
+    }
+
+    f->use_options_cache = use;
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        g_object_set_data(G_OBJECT(value), CPDB_PROXY_OPTIONS_CACHE, GINT_TO_POINTER(use));
+}
+
+void cpdbSetTranslationCacheLimits(cpdb_frontend_obj_t *f,
+                                   int max_locales,
+                                   gsize max_size)
+{
+    gpointer value;
+    GHashTableIter iter;
+
+    if (f == NULL || max_locales < 1)
+    {
+        logwarn("Invalid params: cpdbSetTranslationCacheLimits()\n");
+        return;
+    }
+
+    f->translation_cache_locales = max_locales;
+    f->translation_cache_size = max_size;
+    g_hash_table_iter_init(&iter, f->printer);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        cpdbApplyTranslationCacheLimits(value, max_locales, max_size);
+}
+
+static void cpdbForgetOptionsRevisions(cpdb_frontend_obj_t *f,
+                                       const char *backend_name)
+{
+    PrintBackend *proxy;
+
+    if ((proxy = g_hash_table_lookup(f->backend, backend_name)) != NULL)
+        g_object_set_data(G_OBJECT(proxy), CPDB_PROXY_OPTIONS_REVISIONS, NULL);
+}
+
+/**
+ * TRUE if the options revisions of a backend still have to be fetched
+ * before its options can be looked up in the cache
+ */
+static gboolean cpdbNeedOptionsRevisions(PrintBackend *proxy)
+{
+    if (proxy == NULL || !g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_OPTIONS_CACHE))
+        return FALSE;
+    return g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_OPTIONS_REVISIONS) == NULL &&
+           g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_NO_REVISIONS) == NULL;
+}
+
+static void cpdbStoreOptionsRevisions(PrintBackend *proxy,
+                                      const char *backend_name,
+                                      GVariant *var,
+                                      GError *error)
+{
+    char *printer_id, *revision;
+    GVariantIter iter;
+    GHashTable *revisions;
+
+    if (error)
+    {
+        if (g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+        {
+            loginfo("Backend %s doesn't report options revisions, not caching its options\n",
+                    backend_name);
+            g_object_set_data(G_OBJECT(proxy), CPDB_PROXY_NO_REVISIONS, GINT_TO_POINTER(TRUE));
+        }
+        else
+        {
+            logwarn("Error getting options revisions of %s : %s\n",
+                    backend_name, error->message);
+        }
+        g_error_free(error);
+        return;
+    }
+
+    revisions = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    g_variant_iter_init(&iter, var);
+    while (g_variant_iter_next(&iter, "{ss}", &printer_id, &revision))
+        g_hash_table_replace(revisions, printer_id, revision);
+    g_variant_unref(var);
+    g_object_set_data_full(G_OBJECT(proxy), CPDB_PROXY_OPTIONS_REVISIONS,
+                           revisions, (GDestroyNotify) g_hash_table_destroy);
+}
+
+/**
+ * Fetch the options revisions of the backend of a printer, if needed,
+ * for the synchronous calls
+ */
+static void cpdbFetchOptionsRevisions(cpdb_printer_obj_t *p)
+{
+    gint64 start;
+    GError *error = NULL;
+    GVariant *var = NULL;
+
+    if (!cpdbNeedOptionsRevisions(p->backend_proxy))
+        return;
+
+    start = g_get_monotonic_time();
+    print_backend_call_get_options_revisions_sync(p->backend_proxy,
+                                                  &var,
+                                                  cpdbGetCancellable(p->backend_proxy),
+                                                  &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_OPTIONS_REVISIONS,
+                   p->backend_name, start, error);
+    cpdbStoreOptionsRevisions(p->backend_proxy, p->backend_name, var, error);
+}
+
+typedef void (*cpdb_revisions_callback)(gpointer data, gboolean cancelled);
+
+typedef struct {
+    cpdb_revisions_callback cb;
+    gpointer data;
+} cpdb_revisions_waiter_t;
+
+typedef struct {
+    char *backend_name;     /** Interned **/
+    gint64 start;
+} cpdb_async_revisions_obj_t;
+
+static void options_revisions_cb(PrintBackend *proxy,
+                                 GAsyncResult *res,
+                                 gpointer user_data)
+{
+    gboolean cancelled;
+    GSList *l, *waiters;
+    GError *error = NULL;
+    GVariant *var = NULL;
+    cpdb_revisions_waiter_t *w;
+    cpdb_async_revisions_obj_t *r = user_data;
+
+    print_backend_call_get_options_revisions_finish(proxy, &var, res, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_OPTIONS_REVISIONS, r->backend_name, r->start, error);
+    cancelled = g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED);
+    cpdbStoreOptionsRevisions(proxy, r->backend_name, var, error);
+
+    waiters = g_object_steal_data(G_OBJECT(proxy), CPDB_PROXY_REVISIONS_WAITERS);
+    waiters = g_slist_reverse(waiters);
+    for (l = waiters; l != NULL; l = l->next)
+    {
+        w = l->data;
+        w->cb(w->data, cancelled);
+        free(w);
+    }
+    g_slist_free(waiters);
+    cpdbReleaseString(r->backend_name);
+    free(r);
+}
+
+/**
+ * Call back once the options revisions of a backend are known,
+ * right away if they already are or can't be used.
+ * All the waiters of a backend share a single request.
+ */
+static void cpdbWithOptionsRevisions(PrintBackend *proxy,
+                                     const char *backend_name,
+                                     cpdb_revisions_callback cb,
+                                     gpointer data)
+{
+    GSList *waiters;
+    cpdb_revisions_waiter_t *w;
+    cpdb_async_revisions_obj_t *r;
+
+    if (!cpdbNeedOptionsRevisions(proxy))
+    {
+        cb(data, FALSE);
+        return;
+    }
+
+    w = g_new0(cpdb_revisions_waiter_t, 1);
+    w->cb = cb;
+    w->data = data;
+    waiters = g_object_get_data(G_OBJECT(proxy), CPDB_PROXY_REVISIONS_WAITERS);
+    g_object_set_data(G_OBJECT(proxy), CPDB_PROXY_REVISIONS_WAITERS,
+                      g_slist_prepend(waiters, w));
+    if (waiters != NULL)
+        return;
+
+    r = g_new0(cpdb_async_revisions_obj_t, 1);
+    r->backend_name = cpdbInternString(backend_name);
+    r->start = g_get_monotonic_time();
+    print_backend_call_get_options_revisions(proxy,
+                                             cpdbGetCancellable(proxy),
+                                             (GAsyncReadyCallback) options_revisions_cb,
+                                             r);
+}
+
+/**
+ * Get the options revision of a printer, from the revisions
+ * already fetched for its backend.
+ * NULL if unknown or if the options of the printer can't be cached.
+ */
+static char *cpdbGetOptionsRevision(cpdb_printer_obj_t *p)
+{
+    char *revision;
+    GHashTable *revisions;
+
+    if (p->backend_proxy == NULL ||
+        !g_object_get_data(G_OBJECT(p->backend_proxy), CPDB_PROXY_OPTIONS_CACHE))
+        return NULL;
+    if ((revisions = g_object_get_data(G_OBJECT(p->backend_proxy),
+                                       CPDB_PROXY_OPTIONS_REVISIONS)) == NULL)
+        return NULL;
+
+    revision = g_hash_table_lookup(revisions, p->id);
+    if (revision == NULL || revision[0] == '\0')
+        return NULL;
+    return cpdbGetStringCopy(revision);
+}
+
+/**
+ * Get the options cache file of a printer, and the key it is stored under.
+ * Files are named after a hash of the key, which is checked on loading.
+ */
+static char *cpdbGetOptionsCachePath(const cpdb_printer_obj_t *p,
+                                     char **key)
+{
+    char *cache_dir, *dir, *path, *checksum;
+
+    if ((cache_dir = cpdbGetUserCacheDir()) == NULL)
+    {
+        logerror("Error using options cache : Couldn't obtain user cache dir\n");
+        return NULL;
+    }
+    dir = cpdbConcatPath(cache_dir, CPDB_OPTIONS_CACHE_DIR);
+    free(cache_dir);
+    if (access(dir, R_OK) != 0 && mkdir(dir, CPDB_USRCACHEDIR_PERM) != 0)
+    {
+        logerror("Error using options cache : Couldn't create %s\n", dir);
+        free(dir);
+        return NULL;
+    }
+
+    *key = g_strdup_printf("%s#%s#%s", p->backend_name, p->id,
+                           p->make_and_model ? p->make_and_model : "");
+    checksum = g_compute_checksum_for_string(G_CHECKSUM_SHA256, *key, -1);
+    path = cpdbConcatPath(dir, checksum);
+    g_free(checksum);
+    free(dir);
+    return path;
+}
+
+/**
+ * Get the cached options of a printer, if they are of the given revision.
+ * The variants returned point into the mapped cache file.
+ */
+static gboolean cpdbMapCachedOptions(cpdb_printer_obj_t *p,
+                                     const char *revision,
+                                     int *num_options,
+                                     GVariant **var,
+                                     int *num_media,
+                                     GVariant **media_var)
+{
+    guint32 version;
+    gboolean valid;
+    char *path, *key;
+    const char *cached_key, *cached_revision;
+    GMappedFile *file;
+    GBytes *bytes;
+    GVariant *cache;
+
+    if (revision == NULL)
+        return FALSE;
+    if ((path = cpdbGetOptionsCachePath(p, &key)) == NULL)
+        return FALSE;
+
+    if ((file = g_mapped_file_new(path, FALSE, NULL)) == NULL)
+    {
+        logdebug("No cached options for %s %s\n", p->id, p->backend_name);
+        g_free(key);
+        free(path);
+        return FALSE;
+    }
+    bytes = g_mapped_file_get_bytes(file);
+    g_mapped_file_unref(file);
+    cache = g_variant_ref_sink(g_variant_new_from_bytes(G_VARIANT_TYPE(CPDB_OPTIONS_CACHE_ARGS),
+                                                        bytes, FALSE));
+    g_bytes_unref(bytes);
+
+    g_variant_get(cache, "(u&s&si@a(sssia(s))i@a(siiia(iiii)))",
+                  &version, &cached_key, &cached_revision,
+                  num_options, var, num_media, media_var);
+    valid = version == CPDB_OPTIONS_CACHE_VERSION &&
+            strcmp(cached_key, key) == 0 &&
+            strcmp(cached_revision, revision) == 0;
+    if (!valid)
+    {
+        logdebug("Cached options for %s %s are out of date\n", p->id, p->backend_name);
+        g_variant_unref(*var);
+        g_variant_unref(*media_var);
+    }
+
+    g_variant_unref(cache);
+    g_free(key);
+    free(path);
+    return valid;
+}
+
+static gboolean cpdbLoadCachedOptions(cpdb_printer_obj_t *p,
+                                      const char *revision)
+{
+    int num_options, num_media;
+    GVariant *var, *media_var;
+
+    /* Mapped, the options are unpacked straight from the file */
+    if (!cpdbMapCachedOptions(p, revision, &num_options, &var, &num_media, &media_var))
+        return FALSE;
+
+    loginfo("Using %d cached options and %d media for %s %s\n",
+            num_options, num_media, p->id, p->backend_name);
+    p->options = cpdbGetNewOptions();
+    cpdbUnpackOptions(num_options, var, num_media, media_var, p->options);
+    g_variant_unref(var);
+    g_variant_unref(media_var);
+    return TRUE;
+}
+
+/**
+ * Cache the options of a printer under the revision
+ * it had before they were requested
+ */
+static void cpdbSaveCachedOptions(cpdb_printer_obj_t *p,
+                                  const char *revision,
+                                  int num_options,
+                                  GVariant *var,
+                                  int num_media,
+                                  GVariant *media_var)
+{
+    char *path, *key;
+    GError *error = NULL;
+    GVariant *cache;
+
+    if (revision == NULL)
+        return;
+    if ((path = cpdbGetOptionsCachePath(p, &key)) == NULL)
+        return;
+
+    cache = g_variant_ref_sink(g_variant_new("(ussi@a(sssia(s))i@a(siiia(iiii)))",
+                                             CPDB_OPTIONS_CACHE_VERSION, key, revision,
+                                             num_options, var, num_media, media_var));
+
+    /* Replaced atomically, other processes keep reading the old file */
+    if (!g_file_set_contents(path, g_variant_get_data(cache), g_variant_get_size(cache), &error))
+    {
+        logerror("Error saving options cache for %s %s : %s\n",
+                 p->id, p->backend_name, error->message);
+        g_error_free(error);
+    }
+    else
+    {
+        logdebug("Cached options for %s %s in %s\n", p->id, p->backend_name, path);
+    }
+
+    g_variant_unref(cache);
+    g_free(key);
+    free(path);
+}
+
+typedef enum {
+    CPDB_PREFETCH_IDLE,         /** Waiting for the connection **/
+    CPDB_PREFETCH_STARTED,
+    CPDB_PREFETCH_CANCELLED,    /** Given up on until the next connection **/
+} cpdb_prefetch_state_t;
+
+/**
+ * Prefetch scheduler, also referenced by the requests in flight
+ * which may complete after the frontend is gone
+ */
+struct cpdb_prefetch_s
+{
+    cpdb_frontend_obj_t *f;     /** NULL once prefetching was stopped **/
+    int max_in_flight;          /** Per backend **/
+    cpdb_prefetch_state_t state;
+    GQueue queue;               /** cpdb_prefetch_entry_t, first fetched first **/
+    GHashTable *in_flight;      /**[backend name] --> number of requests in flight **/
+    GHashTable *fetching;       /**[cpdb_printer_key_t] --> cpdb_prefetch_entry_t in flight **/
+};
+
+/**
+ * Printers are only referred to by key, as they may be removed
+ * and deleted while their details are in flight
+ */
+typedef struct {
+    cpdb_prefetch_t *pf;        /** Reference held while in flight **/
+    char *id;
+    char *backend_name;         /** Interned **/
+    GCancellable *cancellable;  /** Of the request in flight **/
+    char *revision;             /** Of the options, captured before requesting them **/
+    gint64 start;
+} cpdb_prefetch_entry_t;
+
+static void cpdbDeletePrefetchEntry(cpdb_prefetch_entry_t *e)
+{
+    if (e->pf)
+        g_rc_box_release_full(e->pf, cpdbClearPrefetch);
+    free(e->id);
+    cpdbReleaseString(e->backend_name);
+    if (e->cancellable)
+        g_object_unref(e->cancellable);
+    free(e->revision);
+    free(e);
+}
+
+static void cpdbCancelPrefetchFetching(cpdb_prefetch_t *pf)
+{
+    GHashTableIter iter;
+    cpdb_prefetch_entry_t *e;
+
+    g_hash_table_iter_init(&iter, pf->fetching);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *) &e))
+        g_cancellable_cancel(e->cancellable);
+}
+
+static void cpdbClearPrefetch(gpointer data)
+{
+    cpdb_prefetch_t *pf = data;
+
+    g_queue_clear_full(&pf->queue, (GDestroyNotify) cpdbDeletePrefetchEntry);
+    g_hash_table_destroy(pf->in_flight);
+    g_hash_table_destroy(pf->fetching);
+}
+
+void cpdbSetPrefetch(cpdb_frontend_obj_t *f,
+                     gboolean prefetch,
+                     int max_in_flight)
+{
+    if (f == NULL)
+    {
+        logwarn("Invalid params: cpdbSetPrefetch()\n");
+        return;
+    }
+
+    if (max_in_flight <= 0)
+        max_in_flight = CPDB_PREFETCH_IN_FLIGHT_DEFAULT;
+    if (!prefetch)
+    {
+        cpdbStopPrefetch(f);
+        return;
+    }
+    if (f->prefetch)
+    {
+        f->prefetch->max_in_flight = max_in_flight;
+        cpdbPumpPrefetch(f->prefetch);
+        return;
+    }
+
+    f->prefetch = g_rc_box_new0(cpdb_prefetch_t);
+    f->prefetch->f = f;
+    f->prefetch->max_in_flight = max_in_flight;
+    f->prefetch->state = CPDB_PREFETCH_IDLE;
+    g_queue_init(&f->prefetch->queue);
+    f->prefetch->in_flight = g_hash_table_new_full(g_str_hash,
+                                                   g_str_equal,
+                                                   (GDestroyNotify) cpdbReleaseString,
+                                                   NULL);
+    f->prefetch->fetching = g_hash_table_new_full(cpdbPrinterKeyHash,
+                                                  cpdbPrinterKeyEqual,
+                                                  free,
+                                                  NULL);
+
+    /* Already connected */
+    if (f->own_id != 0 && !f->connecting && f->connect_cb == NULL)
+        cpdbStartPrefetch(f);
+}
+
+static void cpdbStopPrefetch(cpdb_frontend_obj_t *f)
+{
+    if (f->prefetch == NULL)
+        return;
+
+    /* Requests in flight complete without the frontend */
+    f->prefetch->f = NULL;
+    cpdbCancelPrefetchFetching(f->prefetch);
+    g_queue_clear_full(&f->prefetch->queue, (GDestroyNotify) cpdbDeletePrefetchEntry);
+    g_rc_box_release_full(f->prefetch, cpdbClearPrefetch);
+    f->prefetch = NULL;
+}
+
+static void cpdbCancelPrefetch(cpdb_frontend_obj_t *f)
+{
+    if (f->prefetch == NULL)
+        return;
+
+    /* Given up on for this connection */
+    g_queue_clear_full(&f->prefetch->queue, (GDestroyNotify) cpdbDeletePrefetchEntry);
+    cpdbCancelPrefetchFetching(f->prefetch);
+    f->prefetch->state = CPDB_PREFETCH_CANCELLED;
+}
+
+static void cpdbRestartPrefetch(cpdb_frontend_obj_t *f)
+{
+    /* Started again once the new connection is up */
+    if (f->prefetch != NULL && f->prefetch->state == CPDB_PREFETCH_CANCELLED)
+        f->prefetch->state = CPDB_PREFETCH_IDLE;
+}
+
+/**
+ * Asks the running backends for their default printer in turn,
+ * like the fallbacks of cpdbGetDefaultPrinter() but without blocking
+ */
+typedef struct {
+    cpdb_prefetch_t *pf;        /** Reference held while in flight **/
+    GList *backends;            /** Names of the backends left to ask **/
+    char *backend_name;         /** Of the backend asked right now **/
+    gint64 start;
+} cpdb_prefetch_default_t;
+
+static void cpdbDeletePrefetchDefault(cpdb_prefetch_default_t *d)
+{
+    g_rc_box_release_full(d->pf, cpdbClearPrefetch);
+    g_list_free_full(d->backends, free);
+    free(d->backend_name);
+    free(d);
+}
+
+static void prefetch_default_cb(PrintBackend *proxy,
+                                GAsyncResult *res,
+                                gpointer user_data);
+
+static void cpdbAskPrefetchDefault(cpdb_prefetch_default_t *d)
+{
+    GList *l;
+    PrintBackend *proxy;
+
+    while ((l = d->backends) != NULL)
+    {
+        free(d->backend_name);
+        d->backend_name = l->data;
+        d->backends = g_list_delete_link(d->backends, l);
+
+        /* Not placeholders, which would have to be started */
+        proxy = g_hash_table_lookup(d->pf->f->backend, d->backend_name);
+        if (proxy == NULL || cpdbIsPlaceholderBackend(proxy))
+            continue;
+
+        d->start = g_get_monotonic_time();
+        print_backend_call_get_default_printer(proxy,
+                                               cpdbGetCancellable(proxy),
+                                               (GAsyncReadyCallback) prefetch_default_cb,
+                                               d);
+        return;
+    }
+    cpdbDeletePrefetchDefault(d);
+}
+
+static void prefetch_default_cb(PrintBackend *proxy,
+                                GAsyncResult *res,
+                                gpointer user_data)
+{
+    char *def = NULL;
+    GError *error = NULL;
+    cpdb_printer_obj_t *p;
+    cpdb_prefetch_default_t *d = user_data;
+    cpdb_prefetch_t *pf = d->pf;
+
+    print_backend_call_get_default_printer_finish(proxy, &def, res, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_DEFAULT_PRINTER, d->backend_name, d->start, error);
+    if (pf->f == NULL || pf->state != CPDB_PREFETCH_STARTED ||
+        g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        if (error)
+            g_error_free(error);
+        g_free(def);
+        cpdbDeletePrefetchDefault(d);
+        return;
+    }
+    if (error)
+    {
+        logdebug("Couldn't get default printer of %s : %s\n", d->backend_name, error->message);
+        g_error_free(error);
+        cpdbAskPrefetchDefault(d);
+        return;
+    }
+
+    cpdb_printer_key_t key = { def, d->backend_name };
+    p = g_hash_table_lookup(pf->f->printer, &key);
+    g_free(def);
+    if (p == NULL)
+    {
+        cpdbAskPrefetchDefault(d);
+        return;
+    }
+    cpdbQueuePrefetch(pf, p, TRUE);
+    cpdbPumpPrefetch(pf);
+    cpdbDeletePrefetchDefault(d);
+}
+
+static void cpdbStartPrefetch(cpdb_frontend_obj_t *f)
+{
+    gpointer key, value;
+    GHashTableIter iter;
+    GList *printer, *printers;
+    char *printer_id, *backend_name;
+    gboolean found = FALSE;
+    cpdb_printer_obj_t *p;
+    cpdb_prefetch_default_t *d;
+    cpdb_prefetch_t *pf = f->prefetch;
+
+    if (pf == NULL || pf->state != CPDB_PREFETCH_IDLE)
+        return;
+    pf->state = CPDB_PREFETCH_STARTED;
+
+    g_hash_table_iter_init(&iter, f->printer);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        cpdbQueuePrefetch(pf, value, FALSE);
+
+    /* Configured default printers go first, in their order of preference */
+    printers = g_list_reverse(cpdbLoadAllDefaultPrinters());
+    for (printer = printers; printer != NULL; printer = printer->next)
+    {
+        printer_id = strtok(printer->data, "#");
+        backend_name = strtok(NULL, "\n");
+        if (printer_id == NULL || backend_name == NULL)
+            continue;
+
+        /* Not cpdbFindPrinterObj(), which would start lazy backends */
+        cpdb_printer_key_t key = { printer_id, backend_name };
+        if ((p = g_hash_table_lookup(f->printer, &key)) != NULL)
+        {
+            cpdbQueuePrefetch(pf, p, TRUE);
+            found = TRUE;
+        }
+    }
+    g_list_free_full(printers, free);
+
+    /* Otherwise the one from the backends, asked without waiting for them */
+    if (!found)
+    {
+        d = g_new0(cpdb_prefetch_default_t, 1);
+        d->pf = g_rc_box_acquire(pf);
+        d->backends = g_list_append(d->backends, cpdbGetStringCopy("CUPS"));
+        d->backends = g_list_append(d->backends, cpdbGetStringCopy("FILE"));
+        g_hash_table_iter_init(&iter, f->backend);
+        if (g_hash_table_iter_next(&iter, &key, NULL) &&
+            strcmp(key, "CUPS") != 0 && strcmp(key, "FILE") != 0)
+            d->backends = g_list_append(d->backends, cpdbGetStringCopy(key));
+        cpdbAskPrefetchDefault(d);
+    }
+
+    logdebug("Prefetching details of %u printers\n", g_queue_get_length(&pf->queue));
+    cpdbPumpPrefetch(pf);
+}
+
+static void cpdbQueuePrefetch(cpdb_prefetch_t *pf,
+                              cpdb_printer_obj_t *p,
+                              gboolean first)
+{
+    GList *l;
+    cpdb_prefetch_entry_t *e;
+
+    if (p->options != NULL)
+        return;
+
+    cpdb_printer_key_t key = { p->id, p->backend_name };
+    if (g_hash_table_contains(pf->fetching, &key))
+        return;
+
+    for (l = pf->queue.head; l != NULL; l = l->next)
+    {
+        e = l->data;
+        if (strcmp(e->id, p->id) == 0 && strcmp(e->backend_name, p->backend_name) == 0)
+        {
+            if (first)
+            {
+                g_queue_unlink(&pf->queue, l);
+                g_queue_push_head_link(&pf->queue, l);
+            }
+            return;
+        }
+    }
+
+    e = g_new0(cpdb_prefetch_entry_t, 1);
+    e->id = cpdbGetStringCopy(p->id);
+    e->backend_name = cpdbInternString(p->backend_name);
+    if (first)
+        g_queue_push_head(&pf->queue, e);
+    else
+        g_queue_push_tail(&pf->queue, e);
+}
+
+static void cpdbEndPrefetch(cpdb_prefetch_entry_t *e,
+                            gboolean success)
+{
+    int in_flight;
+    cpdb_prefetch_t *pf = e->pf;
+
+    cpdb_printer_key_t key = { e->id, e->backend_name };
+    g_hash_table_remove(pf->fetching, &key);
+    if (pf->f != NULL)
+    {
+        if (!success)
+            logdebug("Couldn't prefetch details of %s %s\n", e->id, e->backend_name);
+        in_flight = GPOINTER_TO_INT(g_hash_table_lookup(pf->in_flight, e->backend_name));
+        g_hash_table_replace(pf->in_flight, cpdbInternString(e->backend_name),
+                             GINT_TO_POINTER(in_flight - 1));
+        cpdbPumpPrefetch(pf);
+    }
+    cpdbDeletePrefetchEntry(e);
+}
+
+/**
+ * Look the printer of a prefetch entry up again,
+ * NULL if it is gone or no longer needs its details
+ */
+static cpdb_printer_obj_t *cpdbGetPrefetchPrinter(cpdb_prefetch_entry_t *e)
+{
+    cpdb_printer_obj_t *p;
+    cpdb_printer_key_t key = { e->id, e->backend_name };
+
+    if (e->pf->f == NULL || g_cancellable_is_cancelled(e->cancellable))
+        return NULL;
+    p = g_hash_table_lookup(e->pf->f->printer, &key);
+    if (p == NULL || p->backend_proxy == NULL)
+        return NULL;
+    return p;
+}
+
+static void prefetch_details_cb(PrintBackend *proxy,
+                                GAsyncResult *res,
+                                gpointer user_data)
+{
+    cpdb_printer_obj_t *p;
+    GError *error = NULL;
+    int num_options, num_media;
+    GVariant *var, *media_var;
+    cpdb_prefetch_entry_t *e = user_data;
+
+    print_backend_call_get_all_options_finish(proxy,
+                                              &num_options,
+                                              &var,
+                                              &num_media,
+                                              &media_var,
+                                              res,
+                                              &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_ALL_OPTIONS, e->backend_name, e->start, error);
+    if (error)
+    {
+        if (!g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+            logerror("Error acquiring printer details for %s %s : %s\n",
+                     e->id, e->backend_name, error->message);
+        g_error_free(error);
+        cpdbEndPrefetch(e, FALSE);
+        return;
+    }
+
+    loginfo("Acquired %d options and %d media for %s %s\n",
+            num_options, num_media, e->id, e->backend_name);
+    if ((p = cpdbGetPrefetchPrinter(e)) != NULL)
+        cpdbSetPrinterOptions(p, e->revision, num_options, var, num_media, media_var);
+    g_variant_unref(var);
+    g_variant_unref(media_var);
+    cpdbEndPrefetch(e, p != NULL);
+}
+
+static void prefetch_revisions_cb(gpointer user_data,
+                                  gboolean cancelled)
+{
+    cpdb_printer_obj_t *p;
+    cpdb_prefetch_entry_t *e = user_data;
+
+    if (cancelled || (p = cpdbGetPrefetchPrinter(e)) == NULL)
+    {
+        cpdbEndPrefetch(e, FALSE);
+        return;
+    }
+
+    e->revision = cpdbGetOptionsRevision(p);
+    if (p->options || cpdbLoadCachedOptions(p, e->revision))
+    {
+        cpdbEndPrefetch(e, TRUE);
+        return;
+    }
+
+    e->start = g_get_monotonic_time();
+    print_backend_call_get_all_options(p->backend_proxy,
+                                       p->id,
+                                       e->cancellable,
+                                       (GAsyncReadyCallback) prefetch_details_cb,
+                                       e);
+}
+
+static void cpdbPumpPrefetch(cpdb_prefetch_t *pf)
+{
+    int in_flight;
+    GList *l, *next;
+    cpdb_printer_obj_t *p;
+    cpdb_prefetch_entry_t *e;
+    cpdb_printer_key_t *fetching;
+    GCancellable *cancellable;
+
+    if (pf->state != CPDB_PREFETCH_STARTED)
+        return;
+
+    for (l = pf->queue.head; l != NULL; l = next)
+    {
+        next = l->next;
+        e = l->data;
+
+        cpdb_printer_key_t key = { e->id, e->backend_name };
+        p = g_hash_table_lookup(pf->f->printer, &key);
+        if (p == NULL || p->options != NULL || p->backend_proxy == NULL ||
+            cpdbIsPlaceholderBackend(p->backend_proxy))
+        {
+            g_queue_delete_link(&pf->queue, l);
+            cpdbDeletePrefetchEntry(e);
+            continue;
+        }
+
+        /* The printers of other backends can still go ahead */
+        in_flight = GPOINTER_TO_INT(g_hash_table_lookup(pf->in_flight, e->backend_name));
+        if (in_flight >= pf->max_in_flight)
+            continue;
+
+        g_queue_delete_link(&pf->queue, l);
+        g_hash_table_replace(pf->in_flight, cpdbInternString(e->backend_name),
+                             GINT_TO_POINTER(in_flight + 1));
+        fetching = g_new(cpdb_printer_key_t, 1);
+        fetching->id = e->id;
+        fetching->backend_name = e->backend_name;
+        g_hash_table_insert(pf->fetching, fetching, e);
+        e->pf = g_rc_box_acquire(pf);
+
+        /* Also cancelled along with the other calls to the backend */
+        e->cancellable = g_cancellable_new();
+        cancellable = cpdbGetCancellable(p->backend_proxy);
+        if (g_cancellable_is_cancelled(cancellable))
+            g_cancellable_cancel(e->cancellable);
+        logdebug("Prefetching details of %s %s\n", e->id, e->backend_name);
+        cpdbWithOptionsRevisions(p->backend_proxy, p->backend_name,
+                                 prefetch_revisions_cb, e);
+    }
+}
+
+void cpdbPrioritizePrefetch(cpdb_frontend_obj_t *f,
+                            cpdb_printer_obj_t *p)
+{
+    if (f == NULL || p == NULL)
+    {
+        logwarn("Invalid params: cpdbPrioritizePrefetch()\n");
+        return;
+    }
+
+    if (f->prefetch == NULL || f->prefetch->state == CPDB_PREFETCH_CANCELLED)
+        return;
+    cpdbQueuePrefetch(f->prefetch, p, TRUE);
+    cpdbPumpPrefetch(f->prefetch);
+}
+
+typedef struct {
+    cpdb_frontend_obj_t *f;
+    char *backend_name;
+    gint64 start;           /** Of the activation, for tracing **/
+    gint64 call_start;      /** Of the GetPrinterList call **/
+} cpdb_async_backend_obj_t;
+
+static void cpdbFinishPending(cpdb_frontend_obj_t *f)
+{
+    f->num_pending--;
+    if (f->num_pending == 0 && f->name_done)
+        cpdbFinishConnect(f, TRUE);
+}
+
+static void cpdbFinishBackendActivation(cpdb_async_backend_obj_t *a)
+{
+    cpdb_frontend_obj_t *f = a->f;
+
+    cpdbTraceComplete(CPDB_TRACE_ACTIVATION, "ActivateBackend",
+                      a->backend_name, a->start, 0, 0);
+    free(a->backend_name);
+    free(a);
+    cpdbFinishPending(f);
+}
+
+static void get_printer_list_cb(PrintBackend *proxy,
+                                GAsyncResult *res,
+                                gpointer user_data)
+{
+    int num_printers;
+    GVariant *printers;
+    GError *error = NULL;
+    cpdb_async_backend_obj_t *a = user_data;
+
+    print_backend_call_get_printer_list_finish(proxy, &num_printers,
+                                                &printers, res, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_PRINTER_LIST, a->backend_name, a->call_start, error);
+    if (error)
+    {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            /* The frontend might be gone already */
+            g_error_free(error);
+            free(a->backend_name);
+            free(a);
+            return;
+        }
+        logerror("Error getting %s printer list : %s\n",
+                    a->backend_name, error->message);
+        g_error_free(error);
+    }
+    else
+    {
+        logdebug("Fetched %d printers from backend %s\n",
+                    num_printers, a->backend_name);
+        cpdbAddPrintersFromList(a->f, a->backend_name, printers);
+        g_variant_unref(printers);
+    }
+
+    cpdbFinishBackendActivation(a);
+}
+
+static void create_backend_cb(GObject *source_object,
+                              GAsyncResult *res,
+                              gpointer user_data)
+{
+    PrintBackend *proxy, *current;
+    GError *error = NULL;
+    cpdb_async_backend_obj_t *a = user_data;
+    cpdb_frontend_obj_t *f = a->f;
+
+    proxy = print_backend_proxy_new_finish(res, &error);
+    if (error)
+    {
+        if (g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+        {
+            g_error_free(error);
+            free(a->backend_name);
+            free(a);
+            return;
+        }
+        logerror("Error creating backend proxy for %s : %s\n",
+                    a->backend_name, error->message);
+        g_error_free(error);
+
+        /* Can be tried again */
+        if ((current = g_hash_table_lookup(f->backend, a->backend_name)) != NULL)
+            g_object_set_data(G_OBJECT(current), CPDB_PROXY_ACTIVATING, NULL);
+        cpdbFinishBackendActivation(a);
+        return;
+    }
+
+    current = g_hash_table_lookup(f->backend, a->backend_name);
+    if (current != NULL && !cpdbIsPlaceholderBackend(current))
+    {
+        /* Started on demand in the meantime */
+        g_object_unref(proxy);
+        cpdbFinishBackendActivation(a);
+        return;
+    }
+    if (current == NULL)
+        f->num_backends++;
+    cpdbInstallBackendProxy(f, a->backend_name, proxy);
+    a->call_start = g_get_monotonic_time();
+    print_backend_call_get_printer_list(proxy,
+                                        f->cancellable,
+                                        (GAsyncReadyCallback) get_printer_list_cb,
+                                        a);
+}
+
+static void cpdbActivateBackendAsync(cpdb_frontend_obj_t *f,
+                                     const char *service_name)
+{
+    PrintBackend *placeholder;
+    cpdb_async_backend_obj_t *a;
+
+    /* A placeholder only gets replaced once */
+    placeholder = g_hash_table_lookup(f->backend, service_name + strlen(CPDB_BACKEND_PREFIX));
+    if (placeholder != NULL && cpdbIsPlaceholderBackend(placeholder))
+    {
+        if (g_object_get_data(G_OBJECT(placeholder), CPDB_PROXY_ACTIVATING))
+            return;
+        g_object_set_data(G_OBJECT(placeholder), CPDB_PROXY_ACTIVATING, GINT_TO_POINTER(TRUE));
+    }
+
+    a = g_new0(cpdb_async_backend_obj_t, 1);
+    a->f = f;
+    a->backend_name = cpdbGetStringCopy(service_name + strlen(CPDB_BACKEND_PREFIX));
+    a->start = cpdbTraceStart();
+    f->num_pending++;
+
+    logdebug("Activating backend %s asynchronously\n", a->backend_name);
+    print_backend_proxy_new(f->connection,
+                            0,
+                            service_name,
+                            CPDB_BACKEND_OBJ_PATH,
+                            f->cancellable,
+                            create_backend_cb,
+                            a);
+}
+
+/**
+ * Listing of the backends on the bus, started once the placeholders
+ * of the backends of cached printers are there.
+ * Counted in num_pending of the frontend until done.
+ */
+struct cpdb_async_listing_s
+{
+    cpdb_frontend_obj_t *f;
+    int index;              /** Of the name list being fetched **/
+    int num_placeholders;   /** Being created for cached printers **/
+    gboolean listed;        /** Got all the name lists **/
+    GHashTable *found;      /** Backends being activated, which might be in both lists **/
+};
+
+static const char * const cpdb_name_lists[] =
+{
+    "ListNames",
+    "ListActivatableNames",
+    NULL
+};
+
+static void cpdbDeleteListing(cpdb_async_listing_t *l)
+{
+    g_hash_table_destroy(l->found);
+    free(l);
+}
+
+static void cpdbActivateBackends(cpdb_frontend_obj_t *f)
+{
+    cpdb_async_listing_t *l = g_new0(cpdb_async_listing_t, 1);
+
+    logdebug("Activating backends\n");
+    l->f = f;
+    l->index = 0;
+    l->listed = TRUE;
+    l->found = g_hash_table_new_full(g_str_hash, g_str_equal, free, NULL);
+    f->num_pending++;
+
+    if (f->use_printer_cache)
+        cpdbLoadPrinterCache(f, l);
+    if (l->num_placeholders == 0)
+        cpdbListBackendNames(l);
+}
+
+static void list_backend_names_cb(GObject *source_object,
+                                  GAsyncResult *res,
+                                  gpointer user_data)
+{
+    int len;
+    char *service_name, *backend_suffix;
+    gint64 start;
+    gpointer key, value;
+    GHashTableIter backend_iter;
+    GVariantIter *iter;
+    GVariant *service_names_tuple;
+    GError *error = NULL;
+    PrintBackend *backend_proxy, *known;
+    cpdb_async_listing_t *l = user_data;
+    cpdb_frontend_obj_t *f = l->f;
+
+    service_names_tuple = g_dbus_connection_call_finish(G_DBUS_CONNECTION(source_object),
+                                                        res, &error);
+    if (error && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        /* The frontend might be gone already */
+        g_error_free(error);
+        cpdbDeleteListing(l);
+        return;
+    }
+    if (error)
+    {
+        logerror("Couldn't get service names (%s): %s\n",
+                 cpdb_name_lists[l->index], error->message);
+        g_error_free(error);
+        l->listed = FALSE;
+    }
+    else
+    {
+        len = strlen(CPDB_BACKEND_PREFIX);
+        g_variant_get(service_names_tuple, "(as)", &iter);
+        while (g_variant_iter_next(iter, "s", &service_name))
+        {
+            if (!g_str_has_prefix(service_name, CPDB_BACKEND_PREFIX))
+            {
+                g_free(service_name);
+                continue;
+            }
+            backend_suffix = service_name + len;
+            known = g_hash_table_lookup(f->backend, backend_suffix);
+            if ((known != NULL && !cpdbIsPlaceholderBackend(known)) ||
+                g_hash_table_contains(l->found, backend_suffix))
+            {
+                g_free(service_name);
+                continue;
+            }
+            loginfo("Found backend %s (%s)\n", backend_suffix,
+                    l->index ? (f->lazy_activation ? "Starting later" : "Starting now") :
+                    "Already running");
+            g_hash_table_add(l->found, cpdbGetStringCopy(backend_suffix));
+
+            if (l->index && f->lazy_activation)
+            {
+                /* Only started once the backend is actually needed */
+                if (known == NULL)
+                    cpdbCreatePlaceholderBackend(f, NULL, backend_suffix, NULL);
+            }
+            else if (f->activation_mode == CPDB_ACTIVATION_PARALLEL)
+            {
+                cpdbActivateBackendAsync(f, service_name);
+            }
+            else
+            {
+                /* Only with cpdbConnectToDBus(), which waits for the backends anyway */
+                start = cpdbTraceStart();
+                backend_proxy = cpdbCreateBackend(f->connection, service_name);
+                if (backend_proxy != NULL)
+                {
+                    cpdbInstallBackendProxy(f, backend_suffix, backend_proxy);
+                    if (known == NULL)
+                        f->num_backends++;
+                    fetchPrinterListFromBackend(f, backend_suffix);
+                }
+                cpdbTraceComplete(CPDB_TRACE_ACTIVATION, "ActivateBackend",
+                                  backend_suffix, start, 0, 0);
+            }
+            g_free(service_name);
+        }
+        g_variant_iter_free(iter);
+        g_variant_unref(service_names_tuple);
+    }
+
+    l->index++;
+    if (cpdb_name_lists[l->index] != NULL)
+    {
+        cpdbListBackendNames(l);
+        return;
+    }
+
+    /* Backends only known from the printer cache aren't installed anymore */
+    g_hash_table_iter_init(&backend_iter, f->backend);
+    while (l->listed && g_hash_table_iter_next(&backend_iter, &key, &value))
+    {
+        if (g_hash_table_contains(l->found, key) || !cpdbIsPlaceholderBackend(value))
+            continue;
+        loginfo("Cached backend %s is gone\n", (char *) key);
+        cpdbPurgeCachedPrinters(f, key);
+        g_hash_table_iter_remove(&backend_iter);
+        f->num_backends--;
+    }
+    cpdbDeleteListing(l);
+    cpdbFinishPending(f);
+}
+
+static void cpdbListBackendNames(cpdb_async_listing_t *l)
+{
+    cpdb_frontend_obj_t *f = l->f;
+
+    g_dbus_connection_call(f->connection,
+                           "org.freedesktop.DBus",
+                           "/org/freedesktop/DBus",
+                           "org.freedesktop.DBus",
+                           cpdb_name_lists[l->index],
+                           NULL,
+                           G_VARIANT_TYPE("(as)"),
+                           G_DBUS_CALL_FLAGS_NONE,
+                           f->call_timeout,
+                           f->cancellable,
+                           list_backend_names_cb,
+                           l);
+}
+
+PrintBackend *cpdbCreateBackend(GDBusConnection *connection,
+                                const char *service_name)
+{
+    return cpdbCreateBackendWithFlags(connection, service_name,
+                                      G_DBUS_PROXY_FLAGS_NONE);
+}
+
+static PrintBackend *cpdbCreateBackendWithFlags(GDBusConnection *connection,
+                                                const char *service_name,
+                                                GDBusProxyFlags flags)
+{
+    PrintBackend *proxy;
+    GError *error = NULL;
+
+    proxy = print_backend_proxy_new_sync(connection,
+                                         flags,
+                                         service_name,
+                                         CPDB_BACKEND_OBJ_PATH,
+                                         NULL,
+                                         &error);
+    if (error)
+    {
+        logerror("Error creating backend proxy for %s : %s\n",
+                    service_name, error->message);
+        g_error_free(error);
+        return NULL;
+    }
+    return proxy;
+}
+
+static gboolean cpdbIsPlaceholderBackend(PrintBackend *proxy)
+{
+    return (g_dbus_proxy_get_flags(G_DBUS_PROXY(proxy)) &
+            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START) != 0;
+}
+
+typedef struct {
+    cpdb_frontend_obj_t *f;
+    cpdb_async_listing_t *l;    /** Listing waiting for the placeholder, if any **/
+    char *backend_name;
+    GPtrArray *printers;        /** Cached printers of the backend, may be NULL **/
+} cpdb_async_placeholder_obj_t;
+
+static void create_placeholder_cb(GObject *source_object,
+                                  GAsyncResult *res,
+                                  gpointer user_data)
+{
+    guint i;
+    PrintBackend *proxy;
+    GError *error = NULL;
+    cpdb_async_placeholder_obj_t *a = user_data;
+    cpdb_async_listing_t *l = a->l;
+    cpdb_frontend_obj_t *f = a->f;
+
+    proxy = print_backend_proxy_new_finish(res, &error);
+    if (error && g_error_matches(error, G_IO_ERROR, G_IO_ERROR_CANCELLED))
+    {
+        /* The frontend might be gone already */
+        g_error_free(error);
+        for (i = 0; a->printers && i < a->printers->len; i++)
+            cpdbDeletePrinterObj(g_ptr_array_index(a->printers, i));
+        if (l != NULL && --l->num_placeholders == 0)
+            cpdbDeleteListing(l);
+        goto done;
+    }
+
+    if (error)
+    {
+        logerror("Error creating backend proxy for %s : %s\n",
+                    a->backend_name, error->message);
+        g_error_free(error);
+    }
+    else if (g_hash_table_contains(f->backend, a->backend_name))
+    {
+        /* Registered in the meantime */
+        g_object_unref(proxy);
+    }
+    else
+    {
+        cpdbInstallBackendProxy(f, a->backend_name, proxy);
+        f->num_backends++;
+    }
+
+    /* Without a backend, the cached printers are dropped */
+    for (i = 0; a->printers && i < a->printers->len; i++)
+        cpdbAddCachedPrinter(f, g_ptr_array_index(a->printers, i));
+    if (l != NULL && --l->num_placeholders == 0)
+        cpdbListBackendNames(l);
+    cpdbFinishPending(f);
+
+done:
+    if (a->printers)
+        g_ptr_array_free(a->printers, TRUE);
+    free(a->backend_name);
+    free(a);
+}
+
+static void cpdbCreatePlaceholderBackend(cpdb_frontend_obj_t *f,
+                                         cpdb_async_listing_t *l,
+                                         const char *backend_name,
+                                         GPtrArray *printers)
+{
+    char *service_name;
+    cpdb_async_placeholder_obj_t *a = g_new0(cpdb_async_placeholder_obj_t, 1);
+
+    a->f = f;
+    a->l = l;
+    a->backend_name = cpdbGetStringCopy(backend_name);
+    a->printers = printers;
+    f->num_pending++;
+    if (l != NULL)
+        l->num_placeholders++;
+
+    /* A proxy which can't spawn the backend,
+     * replaced once the backend is actually needed */
+    service_name = cpdbConcat(CPDB_BACKEND_PREFIX, backend_name);
+    print_backend_proxy_new(f->connection,
+                            G_DBUS_PROXY_FLAGS_DO_NOT_AUTO_START |
+                            G_DBUS_PROXY_FLAGS_DO_NOT_LOAD_PROPERTIES |
+                            G_DBUS_PROXY_FLAGS_DO_NOT_CONNECT_SIGNALS,
+                            service_name,
+                            CPDB_BACKEND_OBJ_PATH,
+                            f->cancellable,
+                            create_placeholder_cb,
+                            a);
+    free(service_name);
+}
+
+static void cpdbInstallBackendProxy(cpdb_frontend_obj_t *f,
+                                    const char *backend_name,
+                                    PrintBackend *proxy)
+{
+    gpointer value;
+    GHashTableIter iter;
+    cpdb_printer_obj_t *p;
+
+    cpdbSetupBackendProxy(f, backend_name, proxy);
+
+    /* Printers of a placeholder, e.g. announced by the backend
+     * started by someone else, move over to the new proxy */
+    g_hash_table_iter_init(&iter, f->printer);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        p = value;
+        if (p->backend_proxy == proxy || strcmp(p->backend_name, backend_name) != 0)
+            continue;
+        g_object_unref(p->backend_proxy);
+        p->backend_proxy = g_object_ref(proxy);
+    }
+
+    /* The backend table owns the proxy reference */
+    g_hash_table_insert(f->backend, cpdbGetStringCopy(backend_name), proxy);
+}
+
+gboolean cpdbActivateBackend(cpdb_frontend_obj_t *f,
+                             const char *backend_name)
+{
+    char *service_name;
+    gint64 start;
+    PrintBackend *proxy;
+
+    if (f == NULL || backend_name == NULL)
+    {
+        logwarn("Invalid params: cpdbActivateBackend()\n");
+        return FALSE;
+    }
+
+    proxy = g_hash_table_lookup(f->backend, backend_name);
+    if (proxy == NULL)
+    {
+        logwarn("Couldn't find backend proxy for %s\n", backend_name);
+        return FALSE;
+    }
+    if (!cpdbIsPlaceholderBackend(proxy))
+        return TRUE;
+
+    loginfo("Starting backend %s\n", backend_name);
+    start = cpdbTraceStart();
+    service_name = cpdbConcat(CPDB_BACKEND_PREFIX, backend_name);
+    proxy = cpdbCreateBackend(f->connection, service_name);
+    free(service_name);
+    if (proxy == NULL)
+        return FALSE;
+
+    cpdbInstallBackendProxy(f, backend_name, proxy);
+    fetchPrinterListFromBackend(f, backend_name);
+    cpdbTraceComplete(CPDB_TRACE_ACTIVATION, "ActivateBackend",
+                      backend_name, start, 0, 0);
+    return TRUE;
+}
+
+void cpdbIgnoreLastSavedSettings(cpdb_frontend_obj_t *f)
+{
+    loginfo("Ignoring previous settings\n");
+    cpdbDeleteSettings(f->last_saved_settings);
+    f->last_saved_settings = cpdbGetNewSettings();
+}
+
+gboolean cpdbAddPrinter(cpdb_frontend_obj_t *f,
+                        cpdb_printer_obj_t *p)
+{
+    cpdb_printer_key_t *key;
+    cpdb_printer_key_t known = { p->id, p->backend_name };
+
+    /* The table doesn't own its printers, replacing one would leak it */
+    if (g_hash_table_contains(f->printer, &known))
+    {
+        logdebug("Printer %s %s is already known\n", p->id, p->backend_name);
+        return FALSE;
+    }
+    p->backend_proxy = g_hash_table_lookup(f->backend, p->backend_name);
+    if (p->backend_proxy == NULL)
+    {
+        logerror("Couldn't add printer %s : Backend doesn't exist %s\n",
+                    p->id, p->backend_name);
+        return FALSE;
+    }
+    g_object_ref(p->backend_proxy);
+    cpdbApplyTranslationCacheLimits(p, f->translation_cache_locales,
+                                    f->translation_cache_size);
+
+    loginfo("Adding printer %s %s\n", p->id, p->backend_name);
+    cpdbDebugPrinter(p);
+    /* The key points to the strings of the printer it maps to */
+    key = cpdbNewPrinterKey(p);
+    g_hash_table_insert(f->printer, key, p);
+    f->num_printers++;
+
+    if (f->prefetch && f->prefetch->state == CPDB_PREFETCH_STARTED)
+    {
+        cpdbQueuePrefetch(f->prefetch, p, FALSE);
+        cpdbPumpPrefetch(f->prefetch);
+    }
+
+    return TRUE;
+}
+
+cpdb_printer_obj_t *cpdbRemovePrinter(cpdb_frontend_obj_t *f,
+                                      const char *printer_id,
+                                      const char *backend_name)
+{
+    cpdb_printer_key_t key = { printer_id, backend_name };
+    cpdb_printer_obj_t *p;
+    cpdb_prefetch_entry_t *e;
+
+    loginfo("Removing printer %s %s\n", printer_id, backend_name);
+    p = g_hash_table_lookup(f->printer, &key);
+    if (p != NULL)
+    {
+        if (f->prefetch != NULL &&
+            (e = g_hash_table_lookup(f->prefetch->fetching, &key)) != NULL)
+            g_cancellable_cancel(e->cancellable);
+        g_hash_table_remove(f->cached_printers, &key);
+        g_hash_table_remove(f->printer, &key);
+        f->num_printers--;
+    }
+    else
+    {
+        logwarn("Printer %s %s not found\n", printer_id, backend_name);
+    }
+
+    return p;
+}
+
+void cpdbHideRemotePrinters(cpdb_frontend_obj_t *f)
+{
+    loginfo("Hiding remote printers\n");
+    print_frontend_emit_hide_remote_printers(f->skeleton);
+}
+
+void cpdbUnhideRemotePrinters(cpdb_frontend_obj_t *f)
+{
+    loginfo("Unhiding remote printers\n");
+    print_frontend_emit_unhide_remote_printers(f->skeleton);
+}
+
+void cpdbHideTemporaryPrinters(cpdb_frontend_obj_t *f)
+{
+    loginfo("Hiding temporary printers\n");
+    print_frontend_emit_hide_temporary_printers(f->skeleton);
+}
+
+void cpdbUnhideTemporaryPrinters(cpdb_frontend_obj_t *f)
+{
+    loginfo("Unhiding temporary printers\n");
+    print_frontend_emit_unhide_temporary_printers(f->skeleton);
+}
+
+/**
+ * Find a printer, starting its backend if it was registered lazily,
+ * and waiting for it if wait is TRUE.
+ */
+static cpdb_printer_obj_t *cpdbLookupPrinter(cpdb_frontend_obj_t *f,
+                                             const char *printer_id,
+                                             const char *backend_name,
+                                             gboolean wait)
+{
+    cpdb_printer_key_t key = { printer_id, backend_name };
+    char *service_name;
+    PrintBackend *proxy;
+    cpdb_printer_obj_t *p;
+
+    p = g_hash_table_lookup(f->printer, &key);
+    if (p == NULL && (proxy = g_hash_table_lookup(f->backend, backend_name)) != NULL &&
+        cpdbIsPlaceholderBackend(proxy))
+    {
+        if (wait)
+        {
+            cpdbActivateBackend(f, backend_name);
+            p = g_hash_table_lookup(f->printer, &key);
+        }
+        else
+        {
+            loginfo("Starting backend %s in the background\n", backend_name);
+            service_name = cpdbConcat(CPDB_BACKEND_PREFIX, backend_name);
+            cpdbActivateBackendAsync(f, service_name);
+            free(service_name);
+        }
+    }
+    if (p == NULL)
+    {
+        logwarn("Couldn't find printer %s %s : Doesn't exist\n",
+                printer_id, backend_name);
+    }
+
+    return p;
+}
+
+cpdb_printer_obj_t *cpdbFindPrinterObj(cpdb_frontend_obj_t *f,
+                                       const char *printer_id,
+                                       const char *backend_name)
+{
+    if (f == NULL || printer_id == NULL || backend_name == NULL)
+    {
+        logwarn("Invalid parameters: cpdbFindPrinterObj()\n");
+        return NULL;
+    }
+
+    return cpdbLookupPrinter(f, printer_id, backend_name, FALSE);
+}
+
+cpdb_printer_obj_t *cpdbGetDefaultPrinterForBackend(cpdb_frontend_obj_t *f,
+                                                    const char *backend_name)
+{
+    char *def, *service_name;
+    GError *error = NULL;
+    gint64 start;
+    PrintBackend *proxy;
+    cpdb_printer_obj_t *p = NULL;
+    
+    proxy = g_hash_table_lookup(f->backend, backend_name);
+    if (proxy == NULL)
+    {
+        logwarn("Couldn't find backend proxy for %s\n", backend_name);
         service_name = cpdbConcat(CPDB_BACKEND_PREFIX, backend_name);
         proxy = cpdbCreateBackend(f->connection, service_name);
         free(service_name);
@@ -558,16 +2843,27 @@ cpdb_printer_obj_t *cpdbGetDefaultPrinterForBackend(cpdb_frontend_obj_t *f,
             logerror("Error getting default printer for backend : Couldn't get backend proxy\n");
             return NULL;
         }
+        cpdbInstallBackendProxy(f, backend_name, proxy);
+    }
+    else if (cpdbIsPlaceholderBackend(proxy))
+    {
+        if (!cpdbActivateBackend(f, backend_name))
+            return NULL;
+        proxy = g_hash_table_lookup(f->backend, backend_name);
     }
 
-    print_backend_call_get_default_printer_sync(proxy, &def, NULL, &error);
+    start = g_get_monotonic_time();
+    print_backend_call_get_default_printer_sync(proxy, &def, cpdbGetCancellable(proxy), &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_DEFAULT_PRINTER, backend_name, start, error);
     if (error)
     {
         logerror("Error getting default printer for backend : %s\n", error->message);
+        g_error_free(error);
         return NULL;
     }
     
-    p = cpdbFindPrinterObj(f, def, backend_name);
+    p = cpdbLookupPrinter(f, def, backend_name, TRUE);
+    g_free(def);
     if (p)
         logdebug("Obtained default printer %s for backend %s\n", p->id, backend_name);
     return p;
@@ -598,22 +2894,15 @@ GList *cpdbLoadDefaultPrinters(const char *path)
     return printers;
 }
 
-cpdb_printer_obj_t *cpdbGetDefaultPrinter(cpdb_frontend_obj_t *f)
-{   
-    gpointer key, value;
-    GHashTableIter iter;
-    char *conf_dir, *path, *printer_id, *backend_name;
-    cpdb_printer_obj_t *default_printer = NULL;
-    GList *printer, *user_printers, *system_printers, *printers = NULL;
+/**
+ * Default printers from the user config first,
+ * then the ones from the system wide config
+ */
+static GList *cpdbLoadAllDefaultPrinters()
+{
+    char *conf_dir, *path;
+    GList *printers = NULL;
 
-    if (f->num_printers == 0 || f->num_backends == 0)
-    {
-        logwarn("Couldn't get default printer : No printers found\n");
-        return NULL;
-    }
-    
-    /** Find a default printer from user config first,
-     *  before trying system wide config **/
     conf_dir = cpdbGetUserConfDir();
     if (conf_dir)
     {
@@ -625,18 +2914,38 @@ cpdb_printer_obj_t *cpdbGetDefaultPrinter(cpdb_frontend_obj_t *f)
     conf_dir = cpdbGetSysConfDir();
     if (conf_dir)
     {
-        path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
-        printers = g_list_concat(printers, cpdbLoadDefaultPrinters(path));
-        free(path);
-        free(conf_dir);
+        path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
+        printers = g_list_concat(printers, cpdbLoadDefaultPrinters(path));
+        free(path);
+        free(conf_dir);
+    }
+    return printers;
+}
+
+cpdb_printer_obj_t *cpdbGetDefaultPrinter(cpdb_frontend_obj_t *f)
+{   
+    gpointer key, value;
+    GHashTableIter iter;
+    char *printer_id, *backend_name;
+    cpdb_printer_obj_t *default_printer = NULL;
+    GList *printer, *printers;
+
+    /* Lazily registered backends get started by the fallbacks */
+    if ((f->num_printers == 0 && !f->lazy_activation) || f->num_backends == 0)
+    {
+        logwarn("Couldn't get default printer : No printers found\n");
+        return NULL;
     }
     
+    printers = cpdbLoadAllDefaultPrinters();
     for (printer = printers; printer != NULL; printer = printer->next)
     {
         printer_id = strtok(printer->data, "#"); 
         backend_name = strtok(NULL, "\n");
 
-        default_printer = cpdbFindPrinterObj(f, printer_id, backend_name);
+        if (printer_id == NULL || backend_name == NULL)
+            continue;
+        default_printer = cpdbLookupPrinter(f, printer_id, backend_name, TRUE);
         if (default_printer)
         {
             g_list_free_full(printers, free);
@@ -703,169 +3012,783 @@ int cpdbSetDefaultPrinter(const char *path,
         return 0;
     }
 
-    /* Delete duplicate entries */
-    printer = printers;
-    while (printer != NULL)
+    /* Delete duplicate entries */
+    printer = printers;
+    while (printer != NULL)
+    {
+        next = printer->next;
+        if (strcmp(printer->data, printer_data) == 0)
+        {
+            free(printer->data);
+            printers = g_list_delete_link(printers, printer);
+        }
+
+        printer = next;
+    }
+
+    printers = g_list_prepend(printers, printer_data);
+    for (printer = printers; printer != NULL; printer = printer->next)
+    {
+        fprintf(fp, "%s\n", (char *)printer->data);
+    }
+    g_list_free_full(printers, free);
+    loginfo("Saved default printers to %s", path);
+
+    fclose(fp);
+    return 1;
+}
+
+int cpdbSetUserDefaultPrinter(cpdb_printer_obj_t *p)
+{
+    int ret;
+    char *conf_dir, *path;
+
+    if ((conf_dir = cpdbGetUserConfDir()) == NULL)
+    {
+        logerror("Error setting default printer : Couldn't get system config dir\n");
+        return 0;
+    }
+    path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
+    ret = cpdbSetDefaultPrinter(path, p);
+
+    free(path);
+    free(conf_dir);
+    return ret;
+}
+
+int cpdbSetSystemDefaultPrinter(cpdb_printer_obj_t *p)
+{
+    int ret;
+    char *conf_dir, *path;
+
+    if ((conf_dir = cpdbGetSysConfDir()) == NULL)
+    {
+        logerror("Error setting default printer : Couldn't get system config dir\n");
+        return 0;
+    }
+    path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
+    ret = cpdbSetDefaultPrinter(path, p);
+
+    free(path);
+    free(conf_dir);
+    return ret;
+}
+
+int cpdbGetAllJobs(cpdb_frontend_obj_t *f,
+                   cpdb_job_t **j,
+                   gboolean active_only)
+{
+    GList *lazy = NULL, *l;
+    gpointer key, value;
+    GHashTableIter iter;
+
+    /** Lazily registered backends can't answer before being started **/
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        if (cpdbIsPlaceholderBackend(value))
+            lazy = g_list_prepend(lazy, cpdbGetStringCopy(key));
+    }
+    for (l = lazy; l != NULL; l = l->next)
+        cpdbActivateBackend(f, l->data);
+    g_list_free_full(lazy, free);
+    
+	/**inititalizing the arrays required for each of the backends **/
+	
+    /** num_jobs[] stores the number of jobs for each of the backends**/
+    int *num_jobs = g_new(int, f->num_backends);
+    
+    /**backend_names[] stores the name for each of the backends**/
+    char **backend_names = g_new0(char *, f->num_backends);
+    
+    /**retval[] stores the gvariant returned by the respective backend **/
+    GVariant **retval = g_new(GVariant *, f->num_backends);
+    
+    GError *error = NULL;
+    gint64 start;
+    int i = 0, total_jobs = 0;
+ 
+    /** Iterating over all the backends and getting each's active jobs**/
+    g_hash_table_iter_init(&iter, f->backend);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        PrintBackend *proxy = (PrintBackend *)value;
+        
+        backend_names[i] = (char *)key;
+        start = g_get_monotonic_time();
+        print_backend_call_get_all_jobs_sync(proxy,
+                                             active_only,
+                                             &(num_jobs[i]),
+                                             &(retval[i]),
+                                             cpdbGetCancellable(proxy),
+                                             &error);
+        cpdbRecordCall(proxy, CPDB_METHOD_GET_ALL_JOBS, backend_names[i], start, error);
+        
+        if(error)
+        {
+            logerror("Error gettings jobs for backend %s : %s\n",
+                        backend_names[i], error->message);
+        	num_jobs[i] = 0;
+        	
+        }
+        else
+        {
+        	logdebug("Obtained %d jobs for backend %s\n",
+                        num_jobs[i], backend_names[i]);
+        }
+        
+        total_jobs += num_jobs[i];
+        i++; /** off to the next backend **/
+    }
+    
+    int n = 0;
+    cpdb_job_t *jobs = g_new(cpdb_job_t, total_jobs);
+    for (i = 0; i < f->num_backends; i++)
+    {
+    	if(num_jobs[i])
+        {
+    		cpdbUnpackJobArray(retval[i],
+                               num_jobs[i],
+                               jobs + n,
+                               backend_names[i]);
+        }
+        n += num_jobs[i];
+    }
+    *j = jobs;
+
+    free(num_jobs);
+    return total_jobs;
+}
+
+/**
+________________________________________________ cpdb_printer_obj_t __________________________________________
+**/
+
+/**
+ * Key of a cached translation, pointing into its string key in the
+ * translations table, "OPT#name", "OPT#name#choice" or "GRP#name"
+ */
+struct cpdb_translation_key_s
+{
+    cpdb_translation_kind_t kind;
+    const char *name;       /** Option or group name, not NUL-terminated **/
+    gsize name_len;
+    const char *choice;     /** NULL unless kind is CPDB_TRANSLATION_CHOICE **/
+};
+
+static guint cpdbTranslationKeyHash(gconstpointer data)
+{
+    gsize i;
+    const cpdb_translation_key_t *key = data;
+    guint32 h = 5381 + key->kind;
+
+    for (i = 0; i < key->name_len; i++)
+        h = (h << 5) + h + (guchar) key->name[i];
+    if (key->choice)
+        h = (h << 5) + h + g_str_hash(key->choice);
+    return h;
+}
+
+static gboolean cpdbTranslationKeyEqual(gconstpointer a,
+                                        gconstpointer b)
+{
+    const cpdb_translation_key_t *k1 = a, *k2 = b;
+
+    if (k1->kind != k2->kind || k1->name_len != k2->name_len ||
+        memcmp(k1->name, k2->name, k1->name_len) != 0)
+        return FALSE;
+    if (k1->choice == NULL || k2->choice == NULL)
+        return k1->choice == k2->choice;
+    return strcmp(k1->choice, k2->choice) == 0;
+}
+
+/**
+ * Get the key of a translation from its string key, FALSE if of unknown kind.
+ */
+static gboolean cpdbParseTranslationKey(const char *str,
+                                        cpdb_translation_key_t *key)
+{
+    const char *sep;
+
+    /* The sizes of the prefixes count the NUL, i.e. the separator */
+    if (strncmp(str, CPDB_OPT_PREFIX "#", sizeof(CPDB_OPT_PREFIX)) == 0)
+    {
+        key->name = str + sizeof(CPDB_OPT_PREFIX);
+        if ((sep = strchr(key->name, '#')) != NULL)
+        {
+            key->kind = CPDB_TRANSLATION_CHOICE;
+            key->name_len = sep - key->name;
+            key->choice = sep + 1;
+        }
+        else
+        {
+            key->kind = CPDB_TRANSLATION_OPTION;
+            key->name_len = strlen(key->name);
+            key->choice = NULL;
+        }
+        return TRUE;
+    }
+    if (strncmp(str, CPDB_GRP_PREFIX "#", sizeof(CPDB_GRP_PREFIX)) == 0)
+    {
+        key->kind = CPDB_TRANSLATION_GROUP;
+        key->name = str + sizeof(CPDB_GRP_PREFIX);
+        key->name_len = strlen(key->name);
+        key->choice = NULL;
+        return TRUE;
+    }
+    return FALSE;
+}
+
+static char *cpdbFormatTranslationKey(const cpdb_translation_key_t *key)
+{
+    switch (key->kind)
+    {
+        case CPDB_TRANSLATION_OPTION:
+            return g_strdup_printf("%s#%.*s", CPDB_OPT_PREFIX, (int) key->name_len, key->name);
+        case CPDB_TRANSLATION_CHOICE:
+            return g_strdup_printf("%s#%.*s#%s", CPDB_OPT_PREFIX,
+                                   (int) key->name_len, key->name, key->choice);
+        case CPDB_TRANSLATION_GROUP:
+            return g_strdup_printf("%s#%.*s", CPDB_GRP_PREFIX, (int) key->name_len, key->name);
+    }
+    return NULL;
+}
+
+/**
+ * Index a translation of the table by its typed key.
+ */
+static void cpdbIndexTranslation(GHashTable *index,
+                                 const char *str,
+                                 const char *translation)
+{
+    cpdb_translation_key_t *key = g_new(cpdb_translation_key_t, 1);
+
+    if (cpdbParseTranslationKey(str, key))
+        g_hash_table_replace(index, key, (gpointer) translation);
+    else
+        g_free(key);
+}
+
+typedef struct cpdb_translation_entry_s
+{
+    char *locale;
+    GHashTable *translations;
+    GHashTable *index;      /** cpdb_translation_key_t --> translation, of the table above,
+                                or NULL for the ones known to be missing **/
+    GHashTable *missing;    /** Keys the backend has no translation for **/
+    gsize size;
+    gboolean partial;       /** Only single translations, fetching all of them failed **/
+} cpdb_translation_entry_t;
+
+/**
+ * A single GetAllTranslations call per locale, synchronous or not,
+ * which every other request for the locale waits for,
+ * or a single call for a translation missing from them
+ */
+typedef struct cpdb_translation_fill_s
+{
+    char *locale;
+    char *key;              /** Of a single translation, NULL for all of them **/
+    GMainContext *context;  /** Where the reply of an asynchronous call is dispatched, NULL if synchronous **/
+    GSList *waiters;        /** Asynchronous requests completed along with this one **/
+} cpdb_translation_fill_t;
+
+struct cpdb_translation_cache_s
+{
+    GMutex lock;
+    GCond filled;       /** Signalled when a fill is done **/
+    GQueue entries;     /** Most recently used first **/
+    gsize size;
+    int max_locales;
+    gsize max_size;
+    GList *fills;       /** Translation calls in flight **/
+};
+
+static void cpdbDeleteTranslationEntry(cpdb_translation_entry_t *entry)
+{
+    free(entry->locale);
+    g_hash_table_destroy(entry->index);
+    g_hash_table_destroy(entry->missing);
+    g_hash_table_destroy(entry->translations);
+    g_free(entry);
+}
+
+static void cpdbDeleteTranslations(cpdb_printer_obj_t *p)
+{
+    cpdb_translation_cache_t *cache = p->translation_cache;
+
+    if (cache)
+    {
+        g_queue_clear_full(&cache->entries, (GDestroyNotify) cpdbDeleteTranslationEntry);
+        g_mutex_clear(&cache->lock);
+        g_cond_clear(&cache->filled);
+        g_free(cache);
+    }
+
+    p->translation_cache = NULL;
+    p->locale = NULL;
+    p->translations = NULL;
+}
+
+static cpdb_translation_cache_t *cpdbGetTranslationCache(cpdb_printer_obj_t *p)
+{
+    cpdb_translation_cache_t *cache;
+
+    if (p->translation_cache == NULL)
+    {
+        cache = g_new0(cpdb_translation_cache_t, 1);
+        g_mutex_init(&cache->lock);
+        g_cond_init(&cache->filled);
+        g_queue_init(&cache->entries);
+        cache->size = 0;
+        cache->max_locales = CPDB_TRANSLATION_CACHE_LOCALES;
+        cache->max_size = CPDB_TRANSLATION_CACHE_SIZE;
+        cache->fills = NULL;
+        p->translation_cache = cache;
+    }
+    return p->translation_cache;
+}
+
+/**
+ * Drop the least recently used locales beyond the limits,
+ * except the most recently used one.
+ * Must be called with the cache lock held.
+ */
+static void cpdbTrimTranslationCache(cpdb_printer_obj_t *p)
+{
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = p->translation_cache;
+
+    while (cache->entries.length > 1 &&
+           (cache->entries.length > (guint) cache->max_locales || cache->size > cache->max_size))
+    {
+        entry = g_queue_pop_tail(&cache->entries);
+        logdebug("Dropping translations in %s for %s %s\n",
+                 entry->locale, p->id, p->backend_name);
+        cache->size -= entry->size;
+        cpdbDeleteTranslationEntry(entry);
+    }
+}
+
+static void cpdbApplyTranslationCacheLimits(cpdb_printer_obj_t *p,
+                                            int max_locales,
+                                            gsize max_size)
+{
+    cpdb_translation_cache_t *cache = cpdbGetTranslationCache(p);
+
+    g_mutex_lock(&cache->lock);
+    cache->max_locales = max_locales;
+    cache->max_size = max_size;
+    cpdbTrimTranslationCache(p);
+    g_mutex_unlock(&cache->lock);
+}
+
+/**
+ * Get the cached translations of a locale, making it the most recently used.
+ * Must be called with the cache lock held.
+ */
+static cpdb_translation_entry_t *cpdbUseTranslations(cpdb_printer_obj_t *p,
+                                                     const char *locale)
+{
+    GList *link;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = p->translation_cache;
+
+    for (link = cache->entries.head; link != NULL; link = link->next)
+    {
+        entry = link->data;
+        if (strcmp(entry->locale, locale) == 0)
+        {
+            if (link != cache->entries.head)
+            {
+                g_queue_unlink(&cache->entries, link);
+                g_queue_push_head_link(&cache->entries, link);
+                p->locale = entry->locale;
+                p->translations = entry->translations;
+            }
+            return entry;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * TRUE if all the translations of a locale are cached.
+ */
+static gboolean cpdbHasTranslations(cpdb_printer_obj_t *p,
+                                    const char *locale)
+{
+    gboolean found;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = cpdbGetTranslationCache(p);
+
+    g_mutex_lock(&cache->lock);
+    entry = cpdbUseTranslations(p, locale);
+    found = entry != NULL && !entry->partial;
+    g_mutex_unlock(&cache->lock);
+    return found;
+}
+
+/**
+ * Get a copy of a cached translation, NULL if not cached.
+ * cached is set if the translations of the locale were fetched,
+ * missing if the translation is known not to exist.
+ */
+static char *cpdbLookupTranslation(cpdb_printer_obj_t *p,
+                                   const char *locale,
+                                   const cpdb_translation_key_t *key,
+                                   gboolean *cached,
+                                   gboolean *missing)
+{
+    char *translation = NULL;
+    gpointer value;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = cpdbGetTranslationCache(p);
+
+    g_mutex_lock(&cache->lock);
+    *missing = FALSE;
+    if ((entry = cpdbUseTranslations(p, locale)) != NULL &&
+        g_hash_table_lookup_extended(entry->index, key, NULL, &value))
+    {
+        translation = cpdbGetStringCopy(value);
+        *missing = value == NULL;
+    }
+    *cached = entry != NULL;
+    g_mutex_unlock(&cache->lock);
+    return translation;
+}
+
+static gsize cpdbGetTranslationSize(const char *key,
+                                    const char *value)
+{
+    /* The strings, and roughly a node in each table with the typed key */
+    return strlen(key) + strlen(value) + 2 + 6 * sizeof(gpointer) +
+           sizeof(cpdb_translation_key_t);
+}
+
+/**
+ * Add the translations of a locale to the cache, taking ownership of them.
+ * partial is set if they aren't all the translations of the locale.
+ * Must be called with the cache lock held.
+ */
+static void cpdbCacheTranslations(cpdb_printer_obj_t *p,
+                                  const char *locale,
+                                  GHashTable *translations,
+                                  gboolean partial)
+{
+    gpointer key, value;
+    GHashTableIter iter;
+    GList *link;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = p->translation_cache;
+
+    for (link = cache->entries.head; link != NULL; link = link->next)
     {
-        next = printer->next;
-        if (strcmp(printer->data, printer_data) == 0)
+        entry = link->data;
+        if (strcmp(entry->locale, locale) == 0)
         {
-            free(printer->data);
-            printers = g_list_delete_link(printers, printer);
+            g_queue_delete_link(&cache->entries, link);
+            cache->size -= entry->size;
+            cpdbDeleteTranslationEntry(entry);
+            break;
         }
-
-        printer = next;
     }
 
-    printers = g_list_prepend(printers, printer_data);
-    for (printer = printers; printer != NULL; printer = printer->next)
+    entry = g_new0(cpdb_translation_entry_t, 1);
+    entry->locale = cpdbGetStringCopy(locale);
+    entry->translations = translations;
+    entry->index = g_hash_table_new_full(cpdbTranslationKeyHash, cpdbTranslationKeyEqual,
+                                         g_free, NULL);
+    entry->missing = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    entry->size = strlen(locale) + 1;
+    entry->partial = partial;
+    g_hash_table_iter_init(&iter, translations);
+    while (g_hash_table_iter_next(&iter, &key, &value))
     {
-        fprintf(fp, "%s\n", (char *)printer->data);
+        cpdbIndexTranslation(entry->index, key, value);
+        entry->size += cpdbGetTranslationSize(key, value);
     }
-    g_list_free_full(printers, free);
-    loginfo("Saved default printers to %s", path);
 
-    fclose(fp);
-    return 1;
+    g_queue_push_head(&cache->entries, entry);
+    cache->size += entry->size;
+    p->locale = entry->locale;
+    p->translations = entry->translations;
+    cpdbTrimTranslationCache(p);
 }
 
-int cpdbSetUserDefaultPrinter(cpdb_printer_obj_t *p)
+/**
+ * Add a single translation to the cached ones of its locale, if any,
+ * taking ownership of its string key.
+ * A NULL translation is remembered as missing.
+ * Must be called with the cache lock held.
+ */
+static void cpdbAddTranslation(cpdb_printer_obj_t *p,
+                               const char *locale,
+                               const cpdb_translation_key_t *key,
+                               char *str,
+                               const char *translation)
 {
-    int ret;
-    char *conf_dir, *path;
+    char *value;
+    gsize size;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_cache_t *cache = p->translation_cache;
 
-    if ((conf_dir = cpdbGetUserConfDir()) == NULL)
+    if ((entry = cpdbUseTranslations(p, locale)) == NULL ||
+        g_hash_table_contains(entry->index, key))
     {
-        logerror("Error setting default printer : Couldn't get system config dir\n");
-        return 0;
+        g_free(str);
+        return;
     }
-    path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
-    ret = cpdbSetDefaultPrinter(path, p);
 
-    free(path);
-    free(conf_dir);
-    return ret;
+    /* The typed key points into the string key, both stay in sync */
+    if (translation)
+    {
+        value = cpdbGetStringCopy(translation);
+        g_hash_table_replace(entry->translations, str, value);
+        cpdbIndexTranslation(entry->index, str, value);
+        size = cpdbGetTranslationSize(str, translation);
+    }
+    else
+    {
+        g_hash_table_add(entry->missing, str);
+        cpdbIndexTranslation(entry->index, str, NULL);
+        size = cpdbGetTranslationSize(str, "");
+    }
+    entry->size += size;
+    cache->size += size;
+    cpdbTrimTranslationCache(p);
 }
 
-int cpdbSetSystemDefaultPrinter(cpdb_printer_obj_t *p)
+/**
+ * Find the call in flight for a locale, for all its translations
+ * if key is NULL, else for the single one with that string key.
+ * Must be called with the cache lock held.
+ */
+static cpdb_translation_fill_t *cpdbFindTranslationFill(cpdb_translation_cache_t *cache,
+                                                        const char *locale,
+                                                        const char *key)
 {
-    int ret;
-    char *conf_dir, *path;
+    GList *l;
+    cpdb_translation_fill_t *fill;
 
-    if ((conf_dir = cpdbGetSysConfDir()) == NULL)
+    for (l = cache->fills; l != NULL; l = l->next)
     {
-        logerror("Error setting default printer : Couldn't get system config dir\n");
-        return 0;
+        fill = l->data;
+        if (strcmp(fill->locale, locale) == 0 &&
+            (key == NULL ? fill->key == NULL : g_strcmp0(fill->key, key) == 0))
+            return fill;
     }
-    path = cpdbConcatPath(conf_dir, CPDB_DEFAULT_PRINTERS_FILE);
-    ret = cpdbSetDefaultPrinter(path, p);
-
-    free(path);
-    free(conf_dir);
-    return ret;
+    return NULL;
 }
 
-int cpdbGetAllJobs(cpdb_frontend_obj_t *f,
-                   cpdb_job_t **j,
-                   gboolean active_only)
+/**
+ * Wait until the call for a locale, as found above, is no longer in flight.
+ * The reply of an asynchronous call is dispatched in its main context,
+ * which is run here if this thread may, as it would never come otherwise.
+ * Must be called with the cache lock held.
+ */
+static void cpdbWaitTranslationFill(cpdb_translation_cache_t *cache,
+                                    const char *locale,
+                                    const char *key)
 {
-    
-	/**inititalizing the arrays required for each of the backends **/
-	
-    /** num_jobs[] stores the number of jobs for each of the backends**/
-    int *num_jobs = g_new(int, f->num_backends);
-    
-    /**backend_names[] stores the name for each of the backends**/
-    char **backend_names = g_new0(char *, f->num_backends);
-    
-    /**retval[] stores the gvariant returned by the respective backend **/
-    GVariant **retval = g_new(GVariant *, f->num_backends);
-    
-    GError *error = NULL;
-    gpointer key, value;
-    GHashTableIter iter;
-    int i = 0, total_jobs = 0;
- 
-    /** Iterating over all the backends and getting each's active jobs**/
-    g_hash_table_iter_init(&iter, f->backend);
-    while (g_hash_table_iter_next(&iter, &key, &value))
+    GMainContext *context;
+    cpdb_translation_fill_t *fill;
+
+    while ((fill = cpdbFindTranslationFill(cache, locale, key)) != NULL)
     {
-        PrintBackend *proxy = (PrintBackend *)value;
-        
-        backend_names[i] = (char *)key;
-        print_backend_call_get_all_jobs_sync(proxy,
-                                             active_only,
-                                             &(num_jobs[i]),
-                                             &(retval[i]),
-                                             NULL,
-                                             &error);
-        
-        if(error)
+        if (fill->context != NULL && g_main_context_acquire(fill->context))
         {
-            logerror("Error gettings jobs for backend %s : %s\n",
-                        backend_names[i], error->message);
-        	num_jobs[i] = 0;
-        	
+            context = g_main_context_ref(fill->context);
+            g_mutex_unlock(&cache->lock);
+            g_main_context_iteration(context, TRUE);
+            g_main_context_release(context);
+            g_main_context_unref(context);
+            g_mutex_lock(&cache->lock);
         }
         else
         {
-        	logdebug("Obtained %d jobs for backend %s\n",
-                        num_jobs[i], backend_names[i]);
+            g_cond_wait(&cache->filled, &cache->lock);
         }
-        
-        total_jobs += num_jobs[i];
-        i++; /** off to the next backend **/
     }
-    
-    int n = 0;
-    cpdb_job_t *jobs = g_new(cpdb_job_t, total_jobs);
-    for (i = 0; i < f->num_backends; i++)
+}
+
+/* Must be called with the cache lock held */
+static cpdb_translation_fill_t *cpdbStartTranslationFill(cpdb_translation_cache_t *cache,
+                                                         const char *locale,
+                                                         const char *key,
+                                                         GMainContext *context)
+{
+    cpdb_translation_fill_t *fill = g_new0(cpdb_translation_fill_t, 1);
+
+    fill->locale = cpdbGetStringCopy(locale);
+    fill->key = cpdbGetStringCopy(key);
+    fill->context = context ? g_main_context_ref(context) : NULL;
+    fill->waiters = NULL;
+    cache->fills = g_list_prepend(cache->fills, fill);
+    return fill;
+}
+
+/* Must be called with the cache lock held */
+static void cpdbEndTranslationFill(cpdb_translation_cache_t *cache,
+                                   cpdb_translation_fill_t *fill)
+{
+    cache->fills = g_list_remove(cache->fills, fill);
+    g_cond_broadcast(&cache->filled);
+}
+
+static void cpdbDeleteTranslationFill(cpdb_translation_fill_t *fill)
+{
+    free(fill->locale);
+    free(fill->key);
+    if (fill->context)
+        g_main_context_unref(fill->context);
+    g_slist_free(fill->waiters);
+    g_free(fill);
+}
+
+typedef struct {
+    cpdb_printer_obj_t *p;
+    char *locale;
+    cpdb_async_callback caller_cb;
+    void *user_data;
+    GMainContext *context;  /** Thread-default one of the caller, called back there **/
+    gboolean success;
+    gint64 start;
+} cpdb_async_translations_obj_t;
+
+static gboolean cpdbRunTranslationsWaiter(gpointer user_data)
+{
+    cpdb_async_translations_obj_t *w = user_data;
+
+    w->caller_cb(w->p, w->success, w->user_data);
+    g_main_context_unref(w->context);
+    free(w->locale);
+    free(w);
+    return G_SOURCE_REMOVE;
+}
+
+/**
+ * Call back every asynchronous request for the locale made while
+ * the fill was in flight, each in the main context it was made in.
+ * Must be called without the cache lock held.
+ */
+static void cpdbCompleteTranslationWaiters(cpdb_translation_fill_t *fill,
+                                           gboolean success)
+{
+    GSList *l;
+    cpdb_async_translations_obj_t *w;
+
+    fill->waiters = g_slist_reverse(fill->waiters);
+    for (l = fill->waiters; l != NULL; l = l->next)
     {
-    	if(num_jobs[i])
-        {
-    		cpdbUnpackJobArray(retval[i],
-                               num_jobs[i],
-                               jobs + n,
-                               backend_names[i]);
-        }
-        n += num_jobs[i];
+        w = l->data;
+        w->success = success;
+        g_main_context_invoke(w->context, cpdbRunTranslationsWaiter, w);
     }
-    *j = jobs;
+}
 
-    free(num_jobs);
-    return total_jobs;
+/**
+ * Fetch all the translations of a locale with one call, unless cached.
+ * Threads missing the same locale meanwhile wait for this call instead
+ * of making their own.
+ * If keep_failure is set, a failed fetch caches a partial entry with no
+ * translations for the locale, so the single strings fetched instead get
+ * cached there. Partial entries are fetched again unless keep_failure is set.
+ */
+static gboolean cpdbFillTranslations(cpdb_printer_obj_t *p,
+                                     const char *locale,
+                                     gboolean keep_failure)
+{
+    GError *error = NULL;
+    gint64 start;
+    GVariant *translations;
+    GHashTable *table = NULL;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_fill_t *fill;
+    cpdb_translation_cache_t *cache = cpdbGetTranslationCache(p);
+
+    g_mutex_lock(&cache->lock);
+    cpdbWaitTranslationFill(cache, locale, NULL);
+    if ((entry = cpdbUseTranslations(p, locale)) != NULL && (keep_failure || !entry->partial))
+    {
+        g_mutex_unlock(&cache->lock);
+        return TRUE;
+    }
+    fill = cpdbStartTranslationFill(cache, locale, NULL, NULL);
+    g_mutex_unlock(&cache->lock);
+
+    start = g_get_monotonic_time();
+    print_backend_call_get_all_translations_sync(p->backend_proxy,
+                                                 p->id,
+                                                 locale,
+                                                 &translations,
+                                                 cpdbGetCancellable(p->backend_proxy),
+                                                 &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_ALL_TRANSLATIONS, p->backend_name, start, error);
+    if (error)
+    {
+        logerror("Error getting printer translations in %s for %s %s : %s\n",
+                    locale, p->id, p->backend_name, error->message);
+        if (keep_failure)
+            table = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
+    }
+    else
+    {
+        logdebug("Fetched translations for printer %s %s\n", p->id, p->backend_name);
+        table = cpdbUnpackTranslations(translations);
+        g_variant_unref(translations);
+    }
+
+    g_mutex_lock(&cache->lock);
+    if (table)
+        cpdbCacheTranslations(p, locale, table, error != NULL);
+    cpdbEndTranslationFill(cache, fill);
+    g_mutex_unlock(&cache->lock);
+    cpdbCompleteTranslationWaiters(fill, error == NULL);
+    cpdbDeleteTranslationFill(fill);
+
+    if (error)
+    {
+        g_error_free(error);
+        return FALSE;
+    }
+    return TRUE;
 }
 
 /**
-________________________________________________ cpdb_printer_obj_t __________________________________________
-**/
+ * Get a copy of a translation from the cache, fetching all the
+ * translations of the locale first if they weren't.
+ */
+static char *cpdbFindTranslation(cpdb_printer_obj_t *p,
+                                 const char *locale,
+                                 const cpdb_translation_key_t *key,
+                                 gboolean *missing)
+{
+    char *translation;
+    gboolean cached;
+
+    translation = cpdbLookupTranslation(p, locale, key, &cached, missing);
+    if (translation == NULL && !cached && cpdbFillTranslations(p, locale, TRUE))
+        translation = cpdbLookupTranslation(p, locale, key, &cached, missing);
+    return translation;
+}
 
 cpdb_printer_obj_t *cpdbGetNewPrinterObj()
 {
     cpdb_printer_obj_t *p = g_new0 (cpdb_printer_obj_t, 1);
     p->options = NULL;
     p->settings = cpdbGetNewSettings();
+    cpdbGetTranslationCache(p);
     return p;
 }
 
-static void cpdbDeleteTranslations(cpdb_printer_obj_t *p)
-{
-    g_free(p->locale);
-    if (p->translations)
-        g_hash_table_destroy(p->translations);
-
-    p->locale = NULL;
-    p->translations = NULL;
-}
-
 void cpdbDeletePrinterObj(cpdb_printer_obj_t *p)
 {
     if (p == NULL)
         return;
     
     logdebug("Deleting printer object %s\n", p->id);
-    if (p->backend_name)
-        free(p->backend_name);
+    cpdbReleaseString(p->backend_name);
     if (p->backend_proxy)
         g_object_unref(p->backend_proxy);
     if (p->options)
@@ -880,7 +3803,9 @@ void cpdbDeletePrinterObj(cpdb_printer_obj_t *p)
 void cpdbFillBasicOptions(cpdb_printer_obj_t *p,
                           GVariant *gv)
 {
-    g_variant_get(gv, CPDB_PRINTER_ADDED_ARGS,
+    const char *backend_name;
+
+    g_variant_get(gv, "(sssssbs&s)",
                   &(p->id),
                   &(p->name),
                   &(p->info),
@@ -888,11 +3813,15 @@ void cpdbFillBasicOptions(cpdb_printer_obj_t *p,
                   &(p->make_and_model),
                   &(p->accepting_jobs),
                   &(p->state),
-                  &(p->backend_name));
+                  &backend_name);
+    p->backend_name = cpdbInternString(backend_name);
 }
 
 void cpdbDebugPrinter(const cpdb_printer_obj_t *p)
 {
+    if (!cpdbDebugEnabled(CPDB_DEBUG_LEVEL_DEBUG))
+        return;
+
     logdebug("-------------------------\n");
     logdebug("Printer %s\n", p->id);
     logdebug("name: %s\n", p->name);
@@ -908,12 +3837,15 @@ void cpdbDebugPrinter(const cpdb_printer_obj_t *p)
 gboolean cpdbIsAcceptingJobs(cpdb_printer_obj_t *p)
 {
     GError *error = NULL;
+    gint64 start;
     
+    start = g_get_monotonic_time();
     print_backend_call_is_accepting_jobs_sync(p->backend_proxy,
                                               p->id,
                                               &p->accepting_jobs,
-                                              NULL,
+                                              cpdbGetCancellable(p->backend_proxy),
                                               &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_IS_ACCEPTING_JOBS, p->backend_name, start, error);
     if (error)
     {
         logerror("Error getting accepting_jobs status for %s %s : %s\n",
@@ -929,12 +3861,15 @@ gboolean cpdbIsAcceptingJobs(cpdb_printer_obj_t *p)
 char *cpdbGetState(cpdb_printer_obj_t *p)
 {
     GError *error = NULL;
+    gint64 start;
     
+    start = g_get_monotonic_time();
     print_backend_call_get_printer_state_sync(p->backend_proxy,
                                               p->id,
                                               &p->state,
-                                              NULL,
+                                              cpdbGetCancellable(p->backend_proxy),
                                               &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_PRINTER_STATE, p->backend_name, start, error);
     if (error)
     {
         logerror("Error getting printer state for %s %s : %s\n",
@@ -963,20 +3898,34 @@ cpdb_options_t *cpdbGetAllOptions(cpdb_printer_obj_t *p)
         return p->options;
 
     GError *error = NULL;
+    gint64 start;
     int num_options, num_media;
     GVariant *var, *media_var;
+    char *revision;
+
+    cpdbFetchOptionsRevisions(p);
+    revision = cpdbGetOptionsRevision(p);
+    if (cpdbLoadCachedOptions(p, revision))
+    {
+        free(revision);
+        return p->options;
+    }
+
+    start = g_get_monotonic_time();
     print_backend_call_get_all_options_sync(p->backend_proxy,
                                             p->id,
                                             &num_options,
                                             &var,
                                             &num_media,
                                             &media_var,
-                                            NULL,
+                                            cpdbGetCancellable(p->backend_proxy),
                                             &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_ALL_OPTIONS, p->backend_name, start, error);
     if (error)
     {
         logerror("Error getting printer options for %s %s : %s\n",
                     p->id, p->backend_name, error->message);
+        free(revision);
         return NULL;
     }
 
@@ -984,9 +3933,62 @@ cpdb_options_t *cpdbGetAllOptions(cpdb_printer_obj_t *p)
             num_options, num_media, p->id, p->backend_name);
     p->options = cpdbGetNewOptions();
     cpdbUnpackOptions(num_options, var, num_media, media_var, p->options);
+    cpdbSaveCachedOptions(p, revision, num_options, var, num_media, media_var);
+    free(revision);
+    g_variant_unref(var);
+    g_variant_unref(media_var);
     return p->options;
 }
 
+cpdb_options_view_t *cpdbGetOptionsView(cpdb_printer_obj_t *p)
+{
+    if (p == NULL)
+    {
+        logwarn("Invalid params: cpdbGetOptionsView()\n");
+        return NULL;
+    }
+
+    GError *error = NULL;
+    gint64 start;
+    int num_options, num_media;
+    GVariant *var, *media_var;
+    cpdb_options_view_t *view;
+    char *revision;
+
+    cpdbFetchOptionsRevisions(p);
+    revision = cpdbGetOptionsRevision(p);
+    if (!cpdbMapCachedOptions(p, revision, &num_options, &var, &num_media, &media_var))
+    {
+        start = g_get_monotonic_time();
+        print_backend_call_get_all_options_sync(p->backend_proxy,
+                                                p->id,
+                                                &num_options,
+                                                &var,
+                                                &num_media,
+                                                &media_var,
+                                                cpdbGetCancellable(p->backend_proxy),
+                                                &error);
+        cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_ALL_OPTIONS, p->backend_name, start, error);
+        if (error)
+        {
+            logerror("Error getting printer options for %s %s : %s\n",
+                        p->id, p->backend_name, error->message);
+            g_error_free(error);
+            free(revision);
+            return NULL;
+        }
+        cpdbSaveCachedOptions(p, revision, num_options, var, num_media, media_var);
+    }
+    free(revision);
+
+    view = cpdbGetNewOptionsView(var, media_var);
+    loginfo("Obtained view of %d options and %d media for %s %s\n",
+            cpdbGetOptionsViewCount(view), cpdbGetMediaViewCount(view), p->id, p->backend_name);
+    g_variant_unref(var);
+    g_variant_unref(media_var);
+    return view;
+}
+
 cpdb_option_t *cpdbGetOption(cpdb_printer_obj_t *p,
                              const char *name)
 {
@@ -1043,12 +4045,15 @@ int cpdbGetActiveJobsCount(cpdb_printer_obj_t *p)
 {
     int count;
     GError *error = NULL;
+    gint64 start;
     
+    start = g_get_monotonic_time();
     print_backend_call_get_active_jobs_count_sync(p->backend_proxy,
                                                   p->id,
                                                   &count,
-                                                  NULL,
+                                                  cpdbGetCancellable(p->backend_proxy),
                                                   &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_GET_ACTIVE_JOBS_COUNT, p->backend_name, start, error);
     if (error)
     {
         logerror("Error getting active jobs count for % %s : %s\n",
@@ -1078,11 +4083,13 @@ char *cpdbPrintFile(cpdb_printer_obj_t *p,
 {
     char *jobid, *absolute_file_path;
     GError *error = NULL;
+    gint64 start;
     
     absolute_file_path = cpdbGetAbsolutePath(file_path);
     logdebug("Printing file %s on %s %s\n",
                 absolute_file_path, p->id, p->backend_name);
     cpdbDebugPrintSettings(p->settings);
+    start = g_get_monotonic_time();
     print_backend_call_print_file_sync(p->backend_proxy,
                                        p->id,
                                        absolute_file_path,
@@ -1090,8 +4097,9 @@ char *cpdbPrintFile(cpdb_printer_obj_t *p,
                                        cpdbSerializeToGVariant(p->settings),
                                        "final-file-path-not-required",
                                        &jobid,
-                                       NULL,
+                                       cpdbGetCancellable(p->backend_proxy),
                                        &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_PRINT_FILE, p->backend_name, start, error);
                                        
     if (error)
     {
@@ -1120,12 +4128,14 @@ char *cpdbPrintFilePath(cpdb_printer_obj_t *p,
 {
     char *result, *absolute_file_path, *absolute_final_file_path;
     GError *error = NULL;
+    gint64 start;
     
     absolute_file_path = cpdbGetAbsolutePath(file_path);
     absolute_final_file_path = cpdbGetAbsolutePath(final_file_path);
     logdebug("Printing file %s on %s %s to %s\n",
                 absolute_file_path, p->id, p->backend_name, absolute_final_file_path);
     cpdbDebugPrintSettings(p->settings);
+    start = g_get_monotonic_time();
     print_backend_call_print_file_sync(p->backend_proxy,
                                        p->id,
                                        absolute_file_path,
@@ -1133,8 +4143,9 @@ char *cpdbPrintFilePath(cpdb_printer_obj_t *p,
                                        cpdbSerializeToGVariant(p->settings),
                                        absolute_final_file_path,
                                        &result,
-                                       NULL,
+                                       cpdbGetCancellable(p->backend_proxy),
                                        &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_PRINT_FILE, p->backend_name, start, error);
     
     if (error)
     {
@@ -1163,22 +4174,148 @@ void cpdbAddSettingToPrinter(cpdb_printer_obj_t *p,
 {
     if (p == NULL || name == NULL)
     {
-        logwarn("Invalid params: cpdbAddSettingToPrinter()\n");
+        logwarn("Invalid params: cpdbAddSettingToPrinter()\n");
+        return;
+    }
+
+    cpdbAddSetting(p->settings, name, val);
+}
+
+gboolean cpdbClearSettingFromPrinter(cpdb_printer_obj_t *p,
+                                     const char *name)
+{
+    if (p == NULL || name == NULL)
+    {
+        logwarn("Invalid params: cpdbClearSettingFromPrinter()\n");
+        return FALSE;
+    }
+    return cpdbClearSetting(p->settings, name);
+}
+
+static void cpdbAddViolation(GArray *violations,
+                             cpdb_violation_type_t type,
+                             const char *name,
+                             const char *value)
+{
+    cpdb_violation_t v;
+
+    v.type = type;
+    v.option_name = cpdbInternString(name);
+    v.value = cpdbInternString(value);
+    g_array_append_val(violations, v);
+}
+
+/**
+ * Check if a margin setting, if any, is the given margin.
+ */
+static gboolean cpdbMarginMatches(const char *setting,
+                                  int margin)
+{
+    char *end;
+    gint64 value;
+
+    if (setting == NULL)
+        return TRUE;
+
+    value = g_ascii_strtoll(setting, &end, 10);
+    return end != setting && *end == '\0' && value == margin;
+}
+
+static void cpdbValidateMargins(cpdb_options_t *opts,
+                                GHashTable *table,
+                                GArray *violations)
+{
+    int i;
+    const char *media_name, *left, *right, *top, *bottom;
+    cpdb_option_t *opt;
+    cpdb_media_t *media;
+
+    left = g_hash_table_lookup(table, CPDB_OPTION_MARGIN_LEFT);
+    right = g_hash_table_lookup(table, CPDB_OPTION_MARGIN_RIGHT);
+    top = g_hash_table_lookup(table, CPDB_OPTION_MARGIN_TOP);
+    bottom = g_hash_table_lookup(table, CPDB_OPTION_MARGIN_BOTTOM);
+
+    if ((media_name = g_hash_table_lookup(table, CPDB_OPTION_MEDIA)) == NULL)
+    {
+        if (left == NULL && right == NULL && top == NULL && bottom == NULL)
+            return;
+        if ((opt = g_hash_table_lookup(opts->table, CPDB_OPTION_MEDIA)) == NULL)
+            return;
+        media_name = opt->default_value;
+    }
+    else if ((opt = g_hash_table_lookup(opts->table, CPDB_OPTION_MEDIA)) != NULL &&
+             opt->num_supported > 0 && !cpdbIsChoiceSupported(opts, opt, media_name))
+    {
+        /* Already reported as an unsupported value */
+        return;
+    }
+
+    if ((media = g_hash_table_lookup(opts->media, media_name)) == NULL)
+    {
+        if (g_hash_table_size(opts->media) > 0)
+            cpdbAddViolation(violations, CPDB_VIOLATION_UNKNOWN_MEDIA,
+                             CPDB_OPTION_MEDIA, media_name);
         return;
     }
+    if (media->num_margins == 0 ||
+        (left == NULL && right == NULL && top == NULL && bottom == NULL))
+        return;
 
-    cpdbAddSetting(p->settings, name, val);
+    for (i = 0; i < media->num_margins; i++)
+    {
+        if (cpdbMarginMatches(left, media->margins[i].left) &&
+            cpdbMarginMatches(right, media->margins[i].right) &&
+            cpdbMarginMatches(top, media->margins[i].top) &&
+            cpdbMarginMatches(bottom, media->margins[i].bottom))
+            return;
+    }
+    cpdbAddViolation(violations, CPDB_VIOLATION_UNSUPPORTED_MARGINS,
+                     CPDB_OPTION_MEDIA, media_name);
 }
 
-gboolean cpdbClearSettingFromPrinter(cpdb_printer_obj_t *p,
-                                     const char *name)
+int cpdbValidateSettings(cpdb_printer_obj_t *p,
+                         cpdb_settings_t *s,
+                         cpdb_violation_t **violations)
 {
-    if (p == NULL || name == NULL)
+    int num_violations;
+    gpointer key, value;
+    GArray *array;
+    GHashTableIter iter;
+    cpdb_options_t *opts;
+    cpdb_option_t *opt;
+
+    if (p == NULL || violations == NULL)
     {
-        logwarn("Invalid params: cpdbClearSettingFromPrinter()\n");
-        return FALSE;
+        logwarn("Invalid params: cpdbValidateSettings()\n");
+        return -1;
     }
-    return cpdbClearSetting(p->settings, name);
+
+    *violations = NULL;
+    if (s == NULL)
+        s = p->settings;
+    if ((opts = cpdbGetAllOptions(p)) == NULL)
+        return -1;
+
+    array = g_array_new(FALSE, FALSE, sizeof(cpdb_violation_t));
+    g_hash_table_iter_init(&iter, s->table);
+    while (g_hash_table_iter_next(&iter, &key, &value))
+    {
+        if ((opt = g_hash_table_lookup(opts->table, key)) == NULL)
+        {
+            cpdbAddViolation(array, CPDB_VIOLATION_UNKNOWN_OPTION, key, value);
+            continue;
+        }
+        if (opt->num_supported > 0 && !cpdbIsChoiceSupported(opts, opt, value))
+            cpdbAddViolation(array, CPDB_VIOLATION_UNSUPPORTED_VALUE, key, value);
+    }
+    cpdbValidateMargins(opts, s->table, array);
+
+    num_violations = array->len;
+    if (num_violations)
+        logdebug("Found %d invalid settings for %s %s\n",
+                 num_violations, p->id, p->backend_name);
+    *violations = (cpdb_violation_t *) g_array_free(array, num_violations == 0);
+    return num_violations;
 }
 
 gboolean cpdbCancelJob(cpdb_printer_obj_t *p,
@@ -1186,13 +4323,16 @@ gboolean cpdbCancelJob(cpdb_printer_obj_t *p,
 {
     gboolean status;
     GError *error = NULL;
+    gint64 start;
     
+    start = g_get_monotonic_time();
     print_backend_call_cancel_job_sync(p->backend_proxy,
                                        job_id,
                                        p->id,
                                        &status,
-                                       NULL,
+                                       cpdbGetCancellable(p->backend_proxy),
                                        &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_CANCEL_JOB, p->backend_name, start, error);
     if (error)
     {
         logerror("Error cancelling job %s on %s %s\n", 
@@ -1215,8 +4355,13 @@ void cpdbPicklePrinterToFile(cpdb_printer_obj_t *p,
     GHashTableIter iter;
     gpointer key, value;
     GError *error = NULL;
+    gint64 start;
 	
-    print_backend_call_keep_alive_sync(p->backend_proxy, NULL, &error);
+    start = g_get_monotonic_time();
+    print_backend_call_keep_alive_sync(p->backend_proxy,
+                                       cpdbGetCancellable(p->backend_proxy),
+                                       &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_KEEP_ALIVE, p->backend_name, start, error);
     if (error)
     {
         logerror("Error keeping backend %s alive : %s\n",
@@ -1276,6 +4421,7 @@ cpdb_printer_obj_t *cpdbResurrectPrinterFromFile(const char *filename)
     char *name, *value, *path = NULL;
     char *service_name = NULL, *previous_parent_dialog = NULL;
     GError *error = NULL;
+    gint64 start;
     cpdb_printer_obj_t *p;
 
     path = cpdbGetAbsolutePath(filename);
@@ -1294,7 +4440,7 @@ cpdb_printer_obj_t *cpdbResurrectPrinterFromFile(const char *filename)
 
     if (fgets(buf, sizeof(buf), fp) == NULL)
         goto parse_error;
-    p->backend_name = cpdbGetStringCopy(strtok(buf, "#"));
+    p->backend_name = cpdbInternString(strtok(buf, "#"));
     
     service_name = cpdbConcat(CPDB_BACKEND_PREFIX, p->backend_name);
     if ((connection = get_dbus_connection()) == NULL)
@@ -1305,10 +4451,12 @@ cpdb_printer_obj_t *cpdbResurrectPrinterFromFile(const char *filename)
     p->backend_proxy = cpdbCreateBackend(connection,
                                          service_name);
     free(service_name);
+    start = g_get_monotonic_time();
     print_backend_call_replace_sync(p->backend_proxy, 
                                     previous_parent_dialog, 
                                     NULL, 
                                     &error);
+    cpdbRecordCall(p->backend_proxy, CPDB_METHOD_REPLACE, p->backend_name, start, error);
     if (error)
     {
         logerror("Error replacing resurrected printer : %s\n",
@@ -1378,50 +4526,168 @@ failed:
     return NULL;
 }
 
-char *cpdbGetOptionTranslation(cpdb_printer_obj_t *p,
-                               const char *option_name,
-                               const char *locale)
+static const char *cpdb_translation_kinds[] = {
+    "option",
+    "choice",
+    "group",
+};
+
+/**
+ * Get a translation not among all the ones of the locale from the backend.
+ */
+static char *cpdbFetchTranslation(cpdb_printer_obj_t *p,
+                                  const cpdb_translation_key_t *key,
+                                  const char *locale)
 {
-    char *name_key, *translation;
+    char *translation, *result;
     GError *error = NULL;
+    gint64 start;
+    cpdb_backend_method_t method;
 
-    if (p == NULL || option_name == NULL || locale == NULL)
+    start = g_get_monotonic_time();
+    switch (key->kind)
     {
-        logwarn("Invalid paramaters: cpdbGetOptionTranslation()\n");
+        case CPDB_TRANSLATION_OPTION:
+            method = CPDB_METHOD_GET_OPTION_TRANSLATION;
+            print_backend_call_get_option_translation_sync(p->backend_proxy,
+                                                           p->id,
+                                                           key->name,
+                                                           locale,
+                                                           &translation,
+                                                           cpdbGetCancellable(p->backend_proxy),
+                                                           &error);
+            break;
+        case CPDB_TRANSLATION_CHOICE:
+            method = CPDB_METHOD_GET_CHOICE_TRANSLATION;
+            print_backend_call_get_choice_translation_sync(p->backend_proxy,
+                                                           p->id,
+                                                           key->name,
+                                                           key->choice,
+                                                           locale,
+                                                           &translation,
+                                                           cpdbGetCancellable(p->backend_proxy),
+                                                           &error);
+            break;
+        default:
+            method = CPDB_METHOD_GET_GROUP_TRANSLATION;
+            print_backend_call_get_group_translation_sync(p->backend_proxy,
+                                                          p->id,
+                                                          key->name,
+                                                          locale,
+                                                          &translation,
+                                                          cpdbGetCancellable(p->backend_proxy),
+                                                          &error);
+            break;
+    }
+    cpdbRecordCall(p->backend_proxy, method, p->backend_name, start, error);
+    if (error)
+    {
+        logerror("Error getting translation for %s=%s;choice=%s;locale=%s;printer=%s#%s; : %s\n",
+                    cpdb_translation_kinds[key->kind], key->name,
+                    key->choice ? key->choice : "", locale,
+                    p->id, p->backend_name, error->message);
+        g_error_free(error);
         return NULL;
     }
 
-    if (p->locale != NULL && strcmp(p->locale, locale) == 0)
+    logdebug("Obtained translation=%s; for %s=%s;choice=%s;locale=%s;printer=%s#%s;\n",
+                translation, cpdb_translation_kinds[key->kind], key->name,
+                key->choice ? key->choice : "", locale, p->id, p->backend_name);
+    result = cpdbGetStringCopy(translation);
+    g_free(translation);
+    return result;
+}
+
+/**
+ * Get a translation missing from the cached ones of its locale
+ * from the backend, remembering it as missing if it has none either.
+ * Threads missing the same translation meanwhile wait for this call
+ * instead of making their own.
+ */
+static char *cpdbFillTranslation(cpdb_printer_obj_t *p,
+                                 const char *locale,
+                                 const cpdb_translation_key_t *key)
+{
+    char *str, *translation;
+    gpointer value;
+    cpdb_translation_entry_t *entry;
+    cpdb_translation_fill_t *fill;
+    cpdb_translation_cache_t *cache = cpdbGetTranslationCache(p);
+
+    str = cpdbFormatTranslationKey(key);
+    g_mutex_lock(&cache->lock);
+    cpdbWaitTranslationFill(cache, locale, str);
+    if ((entry = cpdbUseTranslations(p, locale)) != NULL &&
+        g_hash_table_lookup_extended(entry->index, key, NULL, &value))
     {
-        name_key = cpdbConcatSep(CPDB_OPT_PREFIX, option_name);
-        translation = g_hash_table_lookup(p->translations, name_key);
-        free(name_key);
-        if (translation)
-        {
-            logdebug("Found translation=%s; for option=%s;locale=%s;printer=%s#%s;\n",
-                        translation, option_name, locale, p->id, p->backend_name);
-            return cpdbGetStringCopy(translation);
-        }
+        /* Fetched by another thread meanwhile */
+        translation = cpdbGetStringCopy(value);
+        g_mutex_unlock(&cache->lock);
+        g_free(str);
+        return translation;
     }
+    fill = cpdbStartTranslationFill(cache, locale, str, NULL);
+    g_mutex_unlock(&cache->lock);
 
-    print_backend_call_get_option_translation_sync(p->backend_proxy,
-                                                   p->id,
-                                                   option_name,
-                                                   locale,
-                                                   &translation,
-                                                   NULL,
-                                                   &error);
-    if (error)
+    translation = cpdbFetchTranslation(p, key, locale);
+
+    g_mutex_lock(&cache->lock);
+    cpdbAddTranslation(p, locale, key, str, translation);
+    cpdbEndTranslationFill(cache, fill);
+    g_mutex_unlock(&cache->lock);
+    cpdbDeleteTranslationFill(fill);
+    return translation;
+}
+
+char *cpdbGetTranslation(cpdb_printer_obj_t *p,
+                         cpdb_translation_kind_t kind,
+                         const char *name,
+                         const char *choice,
+                         const char *locale)
+{
+    char *translation;
+    gboolean missing;
+    cpdb_translation_key_t key;
+
+    if (p == NULL || name == NULL || locale == NULL ||
+        (kind != CPDB_TRANSLATION_OPTION && kind != CPDB_TRANSLATION_CHOICE &&
+         kind != CPDB_TRANSLATION_GROUP) ||
+        (kind == CPDB_TRANSLATION_CHOICE) != (choice != NULL))
     {
-        logerror("Error getting translation for option=%s;locale=%s;printer=%s#%s; : %s\n",
-                    option_name, locale,
-                    p->id, p->backend_name, error->message);
+        logwarn("Invalid paramaters: cpdbGetTranslation()\n");
         return NULL;
     }
-    
-    logdebug("Obtained translation=%s; for option=%s;locale=%s;printer=%s#%s;\n",
-                translation, option_name, locale, p->id, p->backend_name);
-    return cpdbGetStringCopy(translation);
+
+    key.kind = kind;
+    key.name = name;
+    key.name_len = strlen(name);
+    key.choice = choice;
+    if ((translation = cpdbFindTranslation(p, locale, &key, &missing)) != NULL)
+    {
+        logdebug("Found translation=%s; for %s=%s;choice=%s;locale=%s;printer=%s#%s;\n",
+                    translation, cpdb_translation_kinds[kind], name,
+                    choice ? choice : "", locale, p->id, p->backend_name);
+        return translation;
+    }
+
+    if (missing)
+        return NULL;
+
+    /* Not among all the translations, the backend may still have one */
+    return cpdbFillTranslation(p, locale, &key);
+}
+
+char *cpdbGetOptionTranslation(cpdb_printer_obj_t *p,
+                               const char *option_name,
+                               const char *locale)
+{
+    if (p == NULL || option_name == NULL || locale == NULL)
+    {
+        logwarn("Invalid paramaters: cpdbGetOptionTranslation()\n");
+        return NULL;
+    }
+
+    return cpdbGetTranslation(p, CPDB_TRANSLATION_OPTION, option_name, NULL, locale);
 }
 
 char *cpdbGetChoiceTranslation(cpdb_printer_obj_t *p,
@@ -1429,133 +4695,76 @@ char *cpdbGetChoiceTranslation(cpdb_printer_obj_t *p,
                                const char *choice_name,
                                const char *locale)
 {
-    char *name_key, *choice_key, *translation;
-    GError *error = NULL;
-
     if (p == NULL || option_name == NULL || choice_name == NULL || locale == NULL)
     {
         logwarn("Invalid paramaters: cpdbGetChoiceTranslation()\n");
         return NULL;
     }
 
-    if (p->locale != NULL && strcmp(p->locale, locale) == 0)
-    {
-        name_key = cpdbConcatSep(CPDB_OPT_PREFIX, option_name);
-        choice_key = cpdbConcatSep(name_key, choice_name);
-        translation = g_hash_table_lookup(p->translations, choice_key);
-        free(name_key);
-        free(choice_key);
-        if (translation)
-        {
-            logdebug("Found translation=%s; for option=%s;choice=%s;locale=%s;printer=%s#%s;\n",
-                        translation, option_name, choice_name, locale, 
-                        p->id, p->backend_name);
-            return cpdbGetStringCopy(translation);
-        }
-    }
-    
-    print_backend_call_get_choice_translation_sync(p->backend_proxy,
-                                                   p->id,
-                                                   option_name,
-                                                   choice_name,
-                                                   locale,
-                                                   &translation,
-                                                   NULL,
-                                                   &error);
-    if (error)
-    {
-        logerror("Error getting translation for option=%s;choice=%s;locale=%s;printer=%s#%s; : %s\n",
-                    option_name, choice_name, locale,
-                    p->id, p->backend_name, error->message);
-        return NULL;
-    }
-    
-    logdebug("Obtained translation=%s; for option=%s;choice=%s;locale=%s;printer=%s#%s;\n",
-                translation, option_name, choice_name, locale, 
-                p->id, p->backend_name);
-    return cpdbGetStringCopy(translation);
+    return cpdbGetTranslation(p, CPDB_TRANSLATION_CHOICE, option_name, choice_name, locale);
 }
 
-
 char *cpdbGetGroupTranslation(cpdb_printer_obj_t *p,
                               const char *group_name,
                               const char *locale)
 {
-    char *group_key, *translation;
-    GError *error = NULL;
-
     if (p == NULL || group_name == NULL || locale == NULL)
     {
         logwarn("Invalid paramaters: cpdbGetGroupTranslation()\n");
         return NULL;
     }
 
-    if (p->locale != NULL && strcmp(p->locale, locale) == 0)
-    {
-        group_key = cpdbConcatSep(CPDB_GRP_PREFIX, group_name);
-        translation = g_hash_table_lookup(p->translations, group_key);
-        free(group_key);
-        if (translation)
-        {
-            logdebug("Found translation=%s; for group=%s;locale=%s;printer=%s#%s;\n",
-                        translation, group_name, locale, p->id, p->backend_name);
-            return cpdbGetStringCopy(translation);
-        }
-    }
-    
-    print_backend_call_get_group_translation_sync(p->backend_proxy,
-                                                  p->id,
-                                                  group_name,
-                                                  locale,
-                                                  &translation,
-                                                  NULL,
-                                                  &error);
-
-    if (error)
-    {
-        logerror("Error getting translation for group=%s;locale=%s;printer=%s#%s; : %s\n",
-                    group_name, locale,
-                    p->id, p->backend_name, error->message);
-        return NULL;
-    }
-    
-    logdebug("Obtained translation=%s; for group=%s;locale=%s;printer=%s#%s;\n",
-                translation, group_name, locale, p->id, p->backend_name);
-    return cpdbGetStringCopy(translation);
+    return cpdbGetTranslation(p, CPDB_TRANSLATION_GROUP, group_name, NULL, locale);
 }
 
 void cpdbGetAllTranslations(cpdb_printer_obj_t *p,
                             const char *locale)
 {
-    GVariant *translations;
-    GError *error = NULL;
-
     if (p == NULL || locale == NULL)
     {
         logwarn("Invalid parameters: cpdbGetAllTranslations()\n");
         return;
     }
 
-    if (p->locale != NULL && strcmp(p->locale, locale) == 0)
-        return;
+    cpdbFillTranslations(p, locale, FALSE);
+}
 
-    print_backend_call_get_all_translations_sync(p->backend_proxy,
-                                                 p->id,
-                                                 locale,
-                                                 &translations,
-                                                 NULL,
-                                                 &error);
-    if (error)
+gboolean cpdbForEachTranslation(cpdb_printer_obj_t *p,
+                                const char *locale,
+                                cpdb_translation_callback func,
+                                void *user_data)
+{
+    GList *link;
+    gpointer key, value;
+    GHashTableIter iter;
+    cpdb_translation_entry_t *entry = NULL;
+    cpdb_translation_cache_t *cache;
+
+    if (p == NULL || func == NULL)
     {
-        logerror("Error getting printer translations in %s for %s %s : %s\n",
-                    locale, p->id, p->backend_name, error->message);
-        return;
+        logwarn("Invalid parameters: cpdbForEachTranslation()\n");
+        return FALSE;
     }
-    logdebug("Fetched translations for printer %s %s\n", p->id, p->backend_name);
 
-    cpdbDeleteTranslations(p);
-    p->locale = cpdbGetStringCopy(locale);
-    p->translations = cpdbUnpackTranslations(translations);
+    /* Not cpdbUseTranslations(), the recently used order stays as it is */
+    cache = cpdbGetTranslationCache(p);
+    g_mutex_lock(&cache->lock);
+    for (link = cache->entries.head; link != NULL; link = link->next)
+    {
+        if (locale == NULL || strcmp(((cpdb_translation_entry_t *) link->data)->locale, locale) == 0)
+        {
+            entry = link->data;
+            break;
+        }
+    }
+    if (entry)
+    {
+        g_hash_table_iter_init(&iter, entry->translations);
+        while (g_hash_table_iter_next(&iter, &key, &value))
+            func(key, value, user_data);
+    }
+    g_mutex_unlock(&cache->lock);
+    return entry != NULL;
 }
 
 cpdb_media_t *cpdbGetMedia(cpdb_printer_obj_t *p,
@@ -1581,6 +4790,80 @@ int cpdbGetMediaSize(cpdb_printer_obj_t *p,
     return 0;
 }
 
+cpdb_media_t *cpdbGetMediaForSize(cpdb_printer_obj_t *p,
+                                  int width,
+                                  int length,
+                                  int tolerance)
+{
+    int lo, hi, mid, i, count, short_side, long_side, diff, best_diff;
+    gint64 area, best_area;
+    cpdb_media_t *m, *best, **index;
+    cpdb_options_t *opts;
+
+    if (p == NULL || width <= 0 || length <= 0)
+    {
+        logwarn("Invalid params: cpdbGetMediaForSize()\n");
+        return NULL;
+    }
+    if ((opts = cpdbGetAllOptions(p)) == NULL)
+        return NULL;
+    index = cpdbGetMediaIndex(opts, &count);
+    if (tolerance < 0)
+        tolerance = CPDB_MEDIA_SIZE_TOLERANCE;
+
+    short_side = MIN(width, length);
+    long_side = MAX(width, length);
+
+    /* First media with a shorter side within the tolerance */
+    lo = 0;
+    hi = count;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        m = index[mid];
+        if (MIN(m->width, m->length) < short_side - tolerance)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    best = NULL;
+    best_diff = G_MAXINT;
+    for (i = lo; i < count; i++)
+    {
+        m = index[i];
+        if (MIN(m->width, m->length) > short_side + tolerance)
+            break;
+        diff = ABS(MAX(m->width, m->length) - long_side);
+        if (diff > tolerance)
+            continue;
+        diff += ABS(MIN(m->width, m->length) - short_side);
+        if (diff < best_diff)
+        {
+            best = m;
+            best_diff = diff;
+        }
+    }
+    if (best)
+        return best;
+
+    /* The media the page fits on have a shorter side at least as long */
+    best_area = G_MAXINT64;
+    for (i = lo; i < count; i++)
+    {
+        m = index[i];
+        if (MIN(m->width, m->length) < short_side || MAX(m->width, m->length) < long_side)
+            continue;
+        area = (gint64) m->width * m->length;
+        if (area < best_area)
+        {
+            best = m;
+            best_area = area;
+        }
+    }
+    return best;
+}
+
 int cpdbGetMediaMargins(cpdb_printer_obj_t *p,
                         const char *media,
                         cpdb_margin_t **margins)
@@ -1601,8 +4884,42 @@ typedef struct {
     cpdb_printer_obj_t *p;
     cpdb_async_callback caller_cb;
     void *user_data;
+    char *revision;         /** Of the options, captured before requesting them **/
+    gint64 start;
 } cpdb_async_details_obj_t;
 
+static void cpdbDeleteAsyncDetails(cpdb_async_details_obj_t *a)
+{
+    free(a->revision);
+    free(a);
+}
+
+/**
+ * Give a printer the options of a GetAllOptions reply and cache them,
+ * unless it got options from another request in the meantime
+ */
+static void cpdbSetPrinterOptions(cpdb_printer_obj_t *p,
+                                  const char *revision,
+                                  int num_options,
+                                  GVariant *var,
+                                  int num_media,
+                                  GVariant *media_var)
+{
+    cpdb_options_t *options;
+
+    options = cpdbGetNewOptions();
+    cpdbUnpackOptions(num_options, var, num_media, media_var, options);
+    if (p->options == NULL)
+    {
+        p->options = options;
+        cpdbSaveCachedOptions(p, revision, num_options, var, num_media, media_var);
+    }
+    else
+    {
+        cpdbDeleteOptions(options);
+    }
+}
+
 void acquire_details_cb(PrintBackend *proxy,
                         GAsyncResult *res,
                         gpointer user_data)
@@ -1612,7 +4929,6 @@ void acquire_details_cb(PrintBackend *proxy,
     cpdb_printer_obj_t *p = a->p;
     cpdb_async_callback caller_cb = a->caller_cb;
     
-    p->options = cpdbGetNewOptions();
     GError *error = NULL;
     int num_options, num_media;
     GVariant *var, *media_var;
@@ -1624,62 +4940,312 @@ void acquire_details_cb(PrintBackend *proxy,
                                                &media_var,
                                                res,
                                                &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_ALL_OPTIONS, p->backend_name, a->start, error);
+    if (error)
+    {
+        logerror("Error acquiring printer details for %s %s : %s\n",
+                    p->id, p->backend_name, error->message);
+        g_error_free(error);
+        if (caller_cb)
+            caller_cb(p, FALSE, a->user_data);
+    }
+    else
+    {
+        loginfo("Acquired %d options and %d media for %s %s\n",
+                num_options, num_media, p->id, p->backend_name);
+        cpdbSetPrinterOptions(p, a->revision, num_options, var, num_media, media_var);
+        g_variant_unref(var);
+        g_variant_unref(media_var);
+        if (caller_cb)
+            caller_cb(p, TRUE, a->user_data);
+    }
+    
+    cpdbDeleteAsyncDetails(a);
+}
+
+static void acquire_details_revisions_cb(gpointer user_data,
+                                         gboolean cancelled)
+{
+    cpdb_async_details_obj_t *a = user_data;
+    cpdb_printer_obj_t *p = a->p;
+
+    if (cancelled)
+    {
+        if (a->caller_cb)
+            a->caller_cb(p, FALSE, a->user_data);
+        cpdbDeleteAsyncDetails(a);
+        return;
+    }
+
+    a->revision = cpdbGetOptionsRevision(p);
+    if (p->options || cpdbLoadCachedOptions(p, a->revision))
+    {
+        if (a->caller_cb)
+            a->caller_cb(p, TRUE, a->user_data);
+        cpdbDeleteAsyncDetails(a);
+        return;
+    }
+
+    logdebug("Acquiring printer details for %s %s\n", p->id, p->backend_name);
+    a->start = g_get_monotonic_time();
+    print_backend_call_get_all_options(p->backend_proxy,
+                                       p->id, 
+                                       cpdbGetCancellable(p->backend_proxy),
+                                       (GAsyncReadyCallback) acquire_details_cb,
+                                       a);
+}
+
+void cpdbAcquireDetails(cpdb_printer_obj_t *p,
+                        cpdb_async_callback caller_cb,
+                        void *user_data)
+{
+    if (p == NULL)
+    {
+        logwarn("Invalid parameters: cpdbAcquireDetails()\n");
+        return;
+    }
+
+    if (p->options)
+    {
+        if (caller_cb)
+            caller_cb(p, TRUE, user_data);
+        return;
+    }
+    
+    cpdb_async_details_obj_t *a = g_new0(cpdb_async_details_obj_t, 1);
+    a->p = p;
+    a->caller_cb = caller_cb;
+    a->user_data = user_data;
+
+    /* The cache is only consulted once the revisions have arrived */
+    cpdbWithOptionsRevisions(p->backend_proxy, p->backend_name,
+                             acquire_details_revisions_cb, a);
+}
+
+typedef struct {
+    PrintBackend *proxy;
+    GPtrArray *printers;    /** Printers of the same backend **/
+    GHashTable *revisions;  /**[cpdb_printer_obj_t] --> options revision captured before the request **/
+    char *backend_name;     /** Interned **/
+    cpdb_async_callback caller_cb;
+    void *user_data;
+    gint64 start;
+} cpdb_async_batch_obj_t;
+
+static void cpdbDeleteAsyncBatch(cpdb_async_batch_obj_t *b)
+{
+    g_ptr_array_free(b->printers, TRUE);
+    g_hash_table_destroy(b->revisions);
+    cpdbReleaseString(b->backend_name);
+    free(b);
+}
+
+static void acquire_details_batch_cb(PrintBackend *proxy,
+                                     GAsyncResult *res,
+                                     gpointer user_data)
+{
+    int num_options, num_media;
+    guint i;
+    const char *printer_id;
+    gpointer value;
+    GVariant *printers, *var, *media_var;
+    GVariantIter iter;
+    GHashTableIter left_iter;
+    GHashTable *left;
+    GError *error = NULL;
+    cpdb_printer_obj_t *p;
+    cpdb_async_batch_obj_t *b = user_data;
+
+    print_backend_call_get_all_options_batch_finish(proxy, &printers, res, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_ALL_OPTIONS_BATCH, b->backend_name, b->start, error);
+    if (error && g_error_matches(error, G_DBUS_ERROR, G_DBUS_ERROR_UNKNOWN_METHOD))
+    {
+        /* Older backend, don't try again with it */
+        loginfo("Backend %s can't batch option requests, sending them one by one\n",
+                b->backend_name);
+        g_object_set_data(G_OBJECT(proxy), CPDB_PROXY_NO_BATCH, GINT_TO_POINTER(TRUE));
+        for (i = 0; i < b->printers->len; i++)
+            cpdbAcquireDetails(g_ptr_array_index(b->printers, i), b->caller_cb, b->user_data);
+        g_error_free(error);
+        cpdbDeleteAsyncBatch(b);
+        return;
+    }
     if (error)
     {
-        logerror("Error acquiring printer details for %s %s : %s\n",
-                    p->id, p->backend_name, error->message);
-        if (caller_cb)
-            caller_cb(p, FALSE, a->user_data);
+        logerror("Error acquiring details of %u printers of %s : %s\n",
+                    b->printers->len, b->backend_name, error->message);
+        for (i = 0; i < b->printers->len; i++)
+        {
+            if (b->caller_cb)
+                b->caller_cb(g_ptr_array_index(b->printers, i), FALSE, b->user_data);
+        }
+        g_error_free(error);
+        cpdbDeleteAsyncBatch(b);
+        return;
     }
-    else
+
+    left = g_hash_table_new(g_str_hash, g_str_equal);
+    for (i = 0; i < b->printers->len; i++)
+    {
+        p = g_ptr_array_index(b->printers, i);
+        g_hash_table_insert(left, p->id, p);
+    }
+
+    g_variant_iter_init(&iter, printers);
+    while (g_variant_iter_loop(&iter, "(&si@a(sssia(s))i@a(siiia(iiii)))",
+                               &printer_id, &num_options, &var, &num_media, &media_var))
     {
+        if ((p = g_hash_table_lookup(left, printer_id)) == NULL)
+            continue;
+        g_hash_table_remove(left, printer_id);
+
+        /* Unless acquired by another request in the meantime */
+        if (p->options == NULL)
+        {
+            p->options = cpdbGetNewOptions();
+            cpdbUnpackOptions(num_options, var, num_media, media_var, p->options);
+            cpdbSaveCachedOptions(p, g_hash_table_lookup(b->revisions, p),
+                                  num_options, var, num_media, media_var);
+        }
         loginfo("Acquired %d options and %d media for %s %s\n",
                 num_options, num_media, p->id, p->backend_name);
-        cpdbUnpackOptions(num_options, var, num_media, media_var, p->options);
-        if (caller_cb)
-            caller_cb(p, TRUE, a->user_data);
+        if (b->caller_cb)
+            b->caller_cb(p, TRUE, b->user_data);
     }
-    
-    free(a);
+    g_variant_unref(printers);
+
+    g_hash_table_iter_init(&left_iter, left);
+    while (g_hash_table_iter_next(&left_iter, NULL, &value))
+    {
+        p = value;
+        logerror("Backend %s returned no details for %s\n", b->backend_name, p->id);
+        if (b->caller_cb)
+            b->caller_cb(p, FALSE, b->user_data);
+    }
+    g_hash_table_destroy(left);
+    cpdbDeleteAsyncBatch(b);
 }
 
-void cpdbAcquireDetails(cpdb_printer_obj_t *p,
-                        cpdb_async_callback caller_cb,
-                        void *user_data)
+static void acquire_details_batch_revisions_cb(gpointer user_data,
+                                               gboolean cancelled)
 {
-    if (p == NULL)
+    guint i;
+    char *revision;
+    const char **ids;
+    GPtrArray *printers;
+    cpdb_printer_obj_t *p;
+    cpdb_async_batch_obj_t *b = user_data;
+
+    /* Only the printers neither acquired meanwhile nor cached are requested */
+    printers = g_ptr_array_new();
+    for (i = 0; i < b->printers->len; i++)
     {
-        logwarn("Invalid parameters: cpdbAcquireDetails()\n");
-        return;
+        p = g_ptr_array_index(b->printers, i);
+        if (cancelled)
+        {
+            if (b->caller_cb)
+                b->caller_cb(p, FALSE, b->user_data);
+            continue;
+        }
+
+        revision = cpdbGetOptionsRevision(p);
+        if (p->options || cpdbLoadCachedOptions(p, revision))
+        {
+            free(revision);
+            if (b->caller_cb)
+                b->caller_cb(p, TRUE, b->user_data);
+            continue;
+        }
+        g_ptr_array_add(printers, p);
+        if (revision)
+            g_hash_table_insert(b->revisions, p, revision);
     }
+    g_ptr_array_free(b->printers, TRUE);
+    b->printers = printers;
 
-    if (p->options)
+    if (b->printers->len == 0)
     {
-        if (caller_cb)
-            caller_cb(p, TRUE, user_data);
+        cpdbDeleteAsyncBatch(b);
+        return;
+    }
+    if (b->printers->len == 1)
+    {
+        cpdbAcquireDetails(g_ptr_array_index(b->printers, 0), b->caller_cb, b->user_data);
+        cpdbDeleteAsyncBatch(b);
         return;
     }
-    
-    cpdb_async_details_obj_t *a = g_new0(cpdb_async_details_obj_t, 1);
-    a->p = p;
-    a->caller_cb = caller_cb;
-    a->user_data = user_data;
-    
-    logdebug("Acquiring printer details for %s %s\n", p->id, p->backend_name);
-    print_backend_call_get_all_options(p->backend_proxy,
-                                       p->id, 
-                                       NULL,
-                                       (GAsyncReadyCallback) acquire_details_cb,
-                                       a);
-}
 
+    ids = g_new0(const char *, b->printers->len + 1);
+    for (i = 0; i < b->printers->len; i++)
+        ids[i] = ((cpdb_printer_obj_t *) g_ptr_array_index(b->printers, i))->id;
+
+    logdebug("Acquiring details of %u printers of %s\n",
+                b->printers->len, b->backend_name);
+    b->start = g_get_monotonic_time();
+    print_backend_call_get_all_options_batch(b->proxy,
+                                             ids,
+                                             cpdbGetCancellable(b->proxy),
+                                             (GAsyncReadyCallback) acquire_details_batch_cb,
+                                             b);
+    g_free(ids);
+}
 
-typedef struct {
+void cpdbAcquireDetailsBatch(cpdb_printer_obj_t **printer_objs,
+                             int num_printers,
+                             cpdb_async_callback caller_cb,
+                             void *user_data)
+{
+    int i;
+    gpointer value;
+    GHashTable *batches;
+    GHashTableIter iter;
     cpdb_printer_obj_t *p;
-    char *locale;
-    cpdb_async_callback caller_cb;
-    void *user_data;
-} cpdb_async_translations_obj_t;
+    cpdb_async_batch_obj_t *b;
+
+    if (printer_objs == NULL || num_printers < 0)
+    {
+        logwarn("Invalid parameters: cpdbAcquireDetailsBatch()\n");
+        return;
+    }
+
+    /* One batch for each backend */
+    batches = g_hash_table_new(NULL, NULL);
+    for (i = 0; i < num_printers; i++)
+    {
+        p = printer_objs[i];
+        if (p == NULL)
+            continue;
+        if (p->options || p->backend_proxy == NULL ||
+            g_object_get_data(G_OBJECT(p->backend_proxy), CPDB_PROXY_NO_BATCH))
+        {
+            cpdbAcquireDetails(p, caller_cb, user_data);
+            continue;
+        }
+
+        if ((b = g_hash_table_lookup(batches, p->backend_proxy)) == NULL)
+        {
+            b = g_new0(cpdb_async_batch_obj_t, 1);
+            b->proxy = p->backend_proxy;
+            b->printers = g_ptr_array_new();
+            b->revisions = g_hash_table_new_full(NULL, NULL, NULL, free);
+            b->backend_name = cpdbInternString(p->backend_name);
+            b->caller_cb = caller_cb;
+            b->user_data = user_data;
+            g_hash_table_insert(batches, p->backend_proxy, b);
+        }
+        g_ptr_array_add(b->printers, p);
+    }
+
+    /* The cache is only consulted once the revisions have arrived */
+    g_hash_table_iter_init(&iter, batches);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        b = value;
+        cpdbWithOptionsRevisions(b->proxy, b->backend_name,
+                                 acquire_details_batch_revisions_cb, b);
+    }
+    g_hash_table_destroy(batches);
+}
 
 
 static void acquire_translations_cb(PrintBackend *proxy,
@@ -1688,28 +5254,35 @@ static void acquire_translations_cb(PrintBackend *proxy,
 {
     GError *error = NULL;
     GVariant *translations;
+    cpdb_translation_fill_t *fill;
+    cpdb_translation_cache_t *cache;
 
     cpdb_async_translations_obj_t *a = user_data;
     cpdb_printer_obj_t *p = a->p;
 
     print_backend_call_get_all_translations_finish(proxy, &translations,
                                                     res, &error);
+    cpdbRecordCall(proxy, CPDB_METHOD_GET_ALL_TRANSLATIONS, p->backend_name, a->start, error);
+    cache = cpdbGetTranslationCache(p);
+    g_mutex_lock(&cache->lock);
     if (error)
     {
         logerror("Error getting printer translations for %s %s : %s\n",
                     p->id, p->backend_name, error->message);
-        a->caller_cb(p, FALSE, a->user_data);
     }
     else
     {
-        cpdbDeleteTranslations(p);
-        p->locale = cpdbGetStringCopy(a->locale);
-        p->translations = cpdbUnpackTranslations(translations);
-        a->caller_cb(p, TRUE, a->user_data);
+        cpdbCacheTranslations(p, a->locale, cpdbUnpackTranslations(translations), FALSE);
+        g_variant_unref(translations);
     }
+    fill = cpdbFindTranslationFill(cache, a->locale, NULL);
+    cpdbEndTranslationFill(cache, fill);
+    g_mutex_unlock(&cache->lock);
 
-    free(a->locale);
-    free(a);
+    cpdbCompleteTranslationWaiters(fill, error == NULL);
+    cpdbDeleteTranslationFill(fill);
+    if (error)
+        g_error_free(error);
 }
 
 void cpdbAcquireTranslations(cpdb_printer_obj_t *p,
@@ -1717,13 +5290,16 @@ void cpdbAcquireTranslations(cpdb_printer_obj_t *p,
                              cpdb_async_callback caller_cb,
                              void *user_data)
 {
+    cpdb_translation_fill_t *fill;
+    cpdb_translation_cache_t *cache;
+
     if (p == NULL || locale == NULL)
     {
         logwarn("Invalid parameters: cpdbAcquireTranslations()\n");
         return;
     }
 
-    if (p->locale != NULL && strcmp(locale, p->locale) == 0)
+    if (cpdbHasTranslations(p, locale))
     {
         caller_cb(p, TRUE, user_data);
         return;
@@ -1734,13 +5310,30 @@ void cpdbAcquireTranslations(cpdb_printer_obj_t *p,
     a->locale = cpdbGetStringCopy(locale);
     a->caller_cb = caller_cb;
     a->user_data = user_data;
+    a->context = g_main_context_ref_thread_default();
+
+    /* Whether synchronous or not, the call in flight is waited for */
+    cache = cpdbGetTranslationCache(p);
+    g_mutex_lock(&cache->lock);
+    if ((fill = cpdbFindTranslationFill(cache, locale, NULL)) != NULL)
+    {
+        fill->waiters = g_slist_prepend(fill->waiters, a);
+        g_mutex_unlock(&cache->lock);
+        logdebug("Waiting for printer translations for %s %s already being acquired\n",
+                    p->id, p->backend_name);
+        return;
+    }
+    fill = cpdbStartTranslationFill(cache, locale, NULL, a->context);
+    fill->waiters = g_slist_prepend(fill->waiters, a);
+    g_mutex_unlock(&cache->lock);
 
     logdebug("Acquiring printer translations for %s %s\n",
                 p->id, p->backend_name);
+    a->start = g_get_monotonic_time();
     print_backend_call_get_all_translations(p->backend_proxy,
                                             p->id,
                                             locale,
-                                            NULL,
+                                            cpdbGetCancellable(p->backend_proxy),
                                             (GAsyncReadyCallback) acquire_translations_cb,
                                             a);
 }
@@ -1929,57 +5522,209 @@ void cpdbDeleteSettings(cpdb_settings_t *s)
     
     free(s);
 }
+/**
+________________________________________________ cpdb_violation_t __________________________________________
+**/
+void cpdbDeleteViolations(cpdb_violation_t *violations,
+                          int num_violations)
+{
+    int i;
+
+    if (violations == NULL)
+        return;
+
+    for (i = 0; i < num_violations; i++)
+    {
+        cpdbReleaseString(violations[i].option_name);
+        cpdbReleaseString(violations[i].value);
+    }
+    g_free(violations);
+}
+
 /**
 ________________________________________________ cpdb_options_t __________________________________________
 **/
+/**
+ * Private part of an options object, allocated along with it
+ */
+typedef struct {
+    cpdb_options_t options;
+    int media_index_count;
+    cpdb_media_t **media_index; /** Media by shorter then longer side, built when first needed **/
+} cpdb_options_priv_t;
+
+/**
+ * Option unpacked into an options object, allocated from its arena
+ */
+typedef struct {
+    cpdb_option_t option;
+    int *choice_index;          /** Indices of supported_values in strcmp() order **/
+} cpdb_option_priv_t;
+
 cpdb_options_t *cpdbGetNewOptions()
 {
-    cpdb_options_t *o = g_new0(cpdb_options_t, 1);
+    cpdb_options_priv_t *priv = g_new0(cpdb_options_priv_t, 1);
+    cpdb_options_t *o = &priv->options;
     o->count = 0;
-    o->table = g_hash_table_new_full(g_str_hash,
-                                     g_str_equal,
-                                     g_free,
-                                     (GDestroyNotify) cpdbDeleteOption);
+    o->table = g_hash_table_new(g_str_hash, g_str_equal);
     o->media_count = 0;
-    o->media = g_hash_table_new_full(g_str_hash,
-                                     g_str_equal,
-                                     g_free,
-                                     (GDestroyNotify) cpdbDeleteMedia);
+    o->media = g_hash_table_new(g_str_hash, g_str_equal);
+    o->arena = cpdbNewArena(0);
     return o;
 }
 
 void cpdbDeleteOptions(cpdb_options_t *opts)
 {
+    gpointer value;
+    GHashTableIter iter;
+    cpdb_media_t *media;
+
     if (opts == NULL)
         return;
-    
+
+    /* Only the interned strings need to be released one by one,
+     * the rest goes away with the arena */
     if (opts->table)
+    {
+        g_hash_table_iter_init(&iter, opts->table);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+            cpdbReleaseOption(value);
         g_hash_table_destroy(opts->table);
+    }
     if (opts->media)
+    {
+        g_hash_table_iter_init(&iter, opts->media);
+        while (g_hash_table_iter_next(&iter, NULL, &value))
+        {
+            media = value;
+            cpdbReleaseString(media->name);
+        }
         g_hash_table_destroy(opts->media);
+    }
+    cpdbDeleteArena(opts->arena);
 
     free(opts);
 }
 
 /**************cpdb_option_t************************************/
 
+static void cpdbReleaseOption(cpdb_option_t *opt)
+{
+    int i;
+
+    cpdbReleaseString(opt->option_name);
+    cpdbReleaseString(opt->group_name);
+    if (opt->supported_values)
+    {
+        for (i = 0; i < opt->num_supported; i++)
+            cpdbReleaseString(opt->supported_values[i]);
+    }
+    cpdbReleaseString(opt->default_value);
+}
+
 void cpdbDeleteOption(cpdb_option_t *opt)
 {
     if (opt == NULL)
         return;
-    
-    if (opt->option_name)
-        free(opt->option_name);
-    if (opt->group_name)
-        free(opt->group_name);
+
+    cpdbReleaseOption(opt);
     if (opt->supported_values)
         free(opt->supported_values);
-    if (opt->default_value)
-        free(opt->default_value);
 
     free(opt);
 }
 
+typedef struct {
+    const char *value;
+    int index;
+} cpdb_choice_t;
+
+static int compare_choices(const void *a,
+                           const void *b)
+{
+    const cpdb_choice_t *c1 = a, *c2 = b;
+    int cmp;
+
+    /* Duplicates keep their order, the first one is found */
+    if ((cmp = strcmp(c1->value, c2->value)) != 0)
+        return cmp;
+    return c1->index - c2->index;
+}
+
+static int *cpdbIndexChoices(cpdb_arena_t *arena,
+                             char **values,
+                             int num_values)
+{
+    int i, *index;
+    cpdb_choice_t *choices;
+
+    index = cpdbArenaAlloc(arena, sizeof(int) * num_values);
+    if (num_values == 0)
+        return index;
+
+    choices = g_new(cpdb_choice_t, num_values);
+    for (i = 0; i < num_values; i++)
+    {
+        choices[i].value = values[i];
+        choices[i].index = i;
+    }
+    qsort(choices, num_values, sizeof(cpdb_choice_t), compare_choices);
+    for (i = 0; i < num_values; i++)
+        index[i] = choices[i].index;
+    free(choices);
+    return index;
+}
+
+int cpdbGetChoiceIndex(const cpdb_options_t *opts,
+                       const cpdb_option_t *opt,
+                       const char *choice)
+{
+    int i, lo, hi, mid;
+    const int *index = NULL;
+
+    if (opt == NULL || choice == NULL)
+    {
+        logwarn("Invalid params: cpdbGetChoiceIndex()\n");
+        return -1;
+    }
+
+    /* Only the options unpacked into the options object are indexed */
+    if (opts != NULL && opts->table != NULL &&
+        g_hash_table_lookup(opts->table, opt->option_name) == opt)
+        index = ((const cpdb_option_priv_t *) opt)->choice_index;
+    if (index == NULL)
+    {
+        for (i = 0; i < opt->num_supported; i++)
+        {
+            if (strcmp(opt->supported_values[i], choice) == 0)
+                return i;
+        }
+        return -1;
+    }
+
+    lo = 0;
+    hi = opt->num_supported;
+    while (lo < hi)
+    {
+        mid = lo + (hi - lo) / 2;
+        if (strcmp(opt->supported_values[index[mid]], choice) < 0)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    if (lo < opt->num_supported &&
+        strcmp(opt->supported_values[index[lo]], choice) == 0)
+        return index[lo];
+    return -1;
+}
+
+gboolean cpdbIsChoiceSupported(const cpdb_options_t *opts,
+                               const cpdb_option_t *opt,
+                               const char *choice)
+{
+    return cpdbGetChoiceIndex(opts, opt, choice) >= 0;
+}
+
 /**************cpdb_option_t************************************/
 
 void cpdbDeleteMedia(cpdb_media_t *media)
@@ -1987,14 +5732,219 @@ void cpdbDeleteMedia(cpdb_media_t *media)
     if (media == NULL)
         return;
     
-    if (media->name)
-        free(media->name);
+    cpdbReleaseString(media->name);
     if (media->margins)
         free(media->margins);
     
     free(media);
 }
 
+static gint compare_media_sizes(gconstpointer a,
+                                gconstpointer b)
+{
+    const cpdb_media_t *m1 = *(cpdb_media_t * const *) a;
+    const cpdb_media_t *m2 = *(cpdb_media_t * const *) b;
+    int diff;
+
+    if ((diff = MIN(m1->width, m1->length) - MIN(m2->width, m2->length)) != 0)
+        return diff;
+    if ((diff = MAX(m1->width, m1->length) - MAX(m2->width, m2->length)) != 0)
+        return diff;
+    return strcmp(m1->name, m2->name);
+}
+
+/**
+ * Get the media of an options object with fixed dimensions,
+ * by shorter then longer side, indexing them the first time
+ */
+static cpdb_media_t **cpdbGetMediaIndex(cpdb_options_t *opts,
+                                        int *count)
+{
+    int n = 0;
+    gpointer value;
+    GHashTableIter iter;
+    cpdb_media_t *media;
+    cpdb_options_priv_t *priv = (cpdb_options_priv_t *) opts;
+
+    if (priv->media_index)
+    {
+        *count = priv->media_index_count;
+        return priv->media_index;
+    }
+
+    priv->media_index = cpdbArenaAlloc(opts->arena,
+                                       sizeof(cpdb_media_t *) * g_hash_table_size(opts->media));
+
+    /* Media without fixed dimensions can't be matched by size */
+    g_hash_table_iter_init(&iter, opts->media);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+    {
+        media = value;
+        if (media->width > 0 && media->length > 0)
+            priv->media_index[n++] = media;
+    }
+    qsort(priv->media_index, n, sizeof(cpdb_media_t *), compare_media_sizes);
+    priv->media_index_count = n;
+    *count = n;
+    return priv->media_index;
+}
+
+/**
+________________________________________________ cpdb_options_view_t __________________________________________
+**/
+struct cpdb_options_view_s
+{
+    GVariant *options_var;
+    GVariant *media_var;
+    int count;
+    int media_count;
+    cpdb_option_view_t *options;
+    cpdb_media_view_t *media;
+    GHashTable *table;          /**[name] --> cpdb_option_view_t, names point into options_var**/
+    GHashTable *media_table;    /**[name] --> cpdb_media_view_t, names point into media_var**/
+    cpdb_arena_t *arena;        /** Choice and margin arrays **/
+};
+
+cpdb_options_view_t *cpdbGetNewOptionsView(GVariant *options_var,
+                                           GVariant *media_var)
+{
+    int i, j;
+    gint64 start = cpdbTraceStart();
+    GVariant *sub_var;
+    GVariantIter iter, sub_iter;
+    cpdb_option_view_t *opt;
+    cpdb_media_view_t *media;
+    cpdb_margin_t *margins;
+    cpdb_options_view_t *view;
+
+    view = g_new0(cpdb_options_view_t, 1);
+    view->options_var = g_variant_ref_sink(options_var);
+    view->media_var = g_variant_ref_sink(media_var);
+
+    /**
+     * Once serialized, the strings of the variants stay at the same
+     * address for as long as they are referenced, so they can be shared
+     */
+    g_variant_get_data(view->options_var);
+    g_variant_get_data(view->media_var);
+
+    view->arena = cpdbNewArena(0);
+    view->table = g_hash_table_new(g_str_hash, g_str_equal);
+    view->media_table = g_hash_table_new(g_str_hash, g_str_equal);
+
+    view->count = g_variant_n_children(view->options_var);
+    view->options = cpdbArenaAlloc(view->arena, sizeof(cpdb_option_view_t) * view->count);
+    g_variant_iter_init(&iter, view->options_var);
+    for (i = 0; i < view->count; i++)
+    {
+        opt = &view->options[i];
+        g_variant_iter_next(&iter, "(&s&s&si@a(s))",
+                            &opt->option_name, &opt->group_name, &opt->default_value,
+                            &opt->num_supported, &sub_var);
+
+        /* The count sent by the backend isn't trusted for indexing */
+        opt->num_supported = g_variant_n_children(sub_var);
+        opt->supported_values = cpdbArenaAlloc(view->arena,
+                                               sizeof(char *) * opt->num_supported);
+        g_variant_iter_init(&sub_iter, sub_var);
+        for (j = 0; j < opt->num_supported; j++)
+            g_variant_iter_next(&sub_iter, "(&s)", &opt->supported_values[j]);
+        g_variant_unref(sub_var);
+
+        g_hash_table_replace(view->table, (gpointer) opt->option_name, opt);
+    }
+
+    view->media_count = g_variant_n_children(view->media_var);
+    view->media = cpdbArenaAlloc(view->arena, sizeof(cpdb_media_view_t) * view->media_count);
+    g_variant_iter_init(&iter, view->media_var);
+    for (i = 0; i < view->media_count; i++)
+    {
+        media = &view->media[i];
+        g_variant_iter_next(&iter, "(&siii@a(iiii))",
+                            &media->name, &media->width, &media->length,
+                            &media->num_margins, &sub_var);
+
+        media->num_margins = g_variant_n_children(sub_var);
+        margins = cpdbArenaAlloc(view->arena, sizeof(cpdb_margin_t) * media->num_margins);
+        g_variant_iter_init(&sub_iter, sub_var);
+        for (j = 0; j < media->num_margins; j++)
+        {
+            g_variant_iter_next(&sub_iter, "(iiii)",
+                                &margins[j].left, &margins[j].right,
+                                &margins[j].top, &margins[j].bottom);
+        }
+        media->margins = margins;
+        g_variant_unref(sub_var);
+
+        g_hash_table_replace(view->media_table, (gpointer) media->name, media);
+    }
+
+    cpdbTraceComplete(CPDB_TRACE_UNPACK, "GetOptionsView", NULL, start, view->count,
+                      g_variant_get_size(view->options_var) + g_variant_get_size(view->media_var));
+    return view;
+}
+
+int cpdbGetOptionsViewCount(const cpdb_options_view_t *view)
+{
+    return view ? view->count : 0;
+}
+
+const cpdb_option_view_t *cpdbGetOptionViewAt(const cpdb_options_view_t *view,
+                                              int index)
+{
+    if (view == NULL || index < 0 || index >= view->count)
+        return NULL;
+    return &view->options[index];
+}
+
+const cpdb_option_view_t *cpdbLookupOptionView(const cpdb_options_view_t *view,
+                                               const char *name)
+{
+    if (view == NULL || name == NULL)
+    {
+        logwarn("Invalid params: cpdbLookupOptionView()\n");
+        return NULL;
+    }
+    return g_hash_table_lookup(view->table, name);
+}
+
+int cpdbGetMediaViewCount(const cpdb_options_view_t *view)
+{
+    return view ? view->media_count : 0;
+}
+
+const cpdb_media_view_t *cpdbGetMediaViewAt(const cpdb_options_view_t *view,
+                                            int index)
+{
+    if (view == NULL || index < 0 || index >= view->media_count)
+        return NULL;
+    return &view->media[index];
+}
+
+const cpdb_media_view_t *cpdbLookupMediaView(const cpdb_options_view_t *view,
+                                             const char *name)
+{
+    if (view == NULL || name == NULL)
+    {
+        logwarn("Invalid params: cpdbLookupMediaView()\n");
+        return NULL;
+    }
+    return g_hash_table_lookup(view->media_table, name);
+}
+
+void cpdbDeleteOptionsView(cpdb_options_view_t *view)
+{
+    if (view == NULL)
+        return;
+
+    g_hash_table_destroy(view->table);
+    g_hash_table_destroy(view->media_table);
+    cpdbDeleteArena(view->arena);
+    g_variant_unref(view->options_var);
+    g_variant_unref(view->media_var);
+    g_free(view);
+}
+
 /**
  * ________________________________ cpdb_job_t __________________________
  */
@@ -2009,6 +5959,7 @@ void cpdbUnpackJobArray(GVariant *var,
     g_variant_get(var, CPDB_JOB_ARRAY_ARGS, &iter);
     int size;
     char *jobid, *title, *printer, *user, *state, *submit_time;
+    gboolean debug = cpdbDebugEnabled(CPDB_DEBUG_LEVEL_DEBUG);
     for (i = 0; i < num_jobs; i++)
     {
         g_variant_iter_loop(iter,
@@ -2020,24 +5971,49 @@ void cpdbUnpackJobArray(GVariant *var,
                             &state,
                             &submit_time,
                             &size);
-        logdebug("jobid=%s;\n", jobid);
+        if (debug)
+        {
+            logdebug("jobid=%s;\n", jobid);
+            logdebug("title=%s;\n", title);
+            logdebug("printer=%s;\n", printer);
+            logdebug("backend_name=%s;\n", backend_name);
+            logdebug("user=%s;\n", user);
+            logdebug("state=%s;\n", state);
+            logdebug("submit_time=%s;\n", submit_time);
+            logdebug("size=%d;\n", size);
+        }
         jobs[i].job_id = cpdbGetStringCopy(jobid);
-        logdebug("title=%s;\n", title);
         jobs[i].title = cpdbGetStringCopy(title);
-        logdebug("printer=%s;\n", printer);
         jobs[i].printer_id = cpdbGetStringCopy(printer);
-        logdebug("backend_name=%s;\n", backend_name);
-        jobs[i].backend_name = backend_name;
-        logdebug("user=%s;\n", user);
+        jobs[i].backend_name = cpdbInternString(backend_name);
         jobs[i].user = cpdbGetStringCopy(user);
-        logdebug("state=%s;\n", state);
         jobs[i].state = cpdbGetStringCopy(state);
-        logdebug("submit_time=%s;\n", submit_time);
         jobs[i].submitted_at = cpdbGetStringCopy(submit_time);
-        logdebug("size=%d;\n", size);
         jobs[i].size = size;
     }
 }
+
+void cpdbDeleteJobs(cpdb_job_t *jobs,
+                    int num_jobs)
+{
+    int i;
+
+    if (jobs == NULL)
+        return;
+
+    for (i = 0; i < num_jobs; i++)
+    {
+        free(jobs[i].job_id);
+        free(jobs[i].title);
+        free(jobs[i].printer_id);
+        cpdbReleaseString(jobs[i].backend_name);
+        free(jobs[i].user);
+        free(jobs[i].state);
+        free(jobs[i].submitted_at);
+    }
+    free(jobs);
+}
+
 /**
  * ________________________________utility functions__________________________
  */
@@ -2048,69 +6024,101 @@ void cpdbUnpackOptions(int num_options,
                        GVariant *media_var,
                        cpdb_options_t *options)
 {
-    cpdb_option_t *opt;
-    cpdb_media_t *media;
+    cpdb_option_t *opt, *old_opt;
+    cpdb_option_priv_t *priv;
+    cpdb_media_t *media, *old_media;
     char buf[CPDB_BSIZE];
     int i, j, num, width, length, l, r, t, b;
     GVariantIter *iter, *sub_iter;
-    char *str, *name, *def, *group;
-    
-    options->count = num_options;
+    const char *str, *name, *def, *group;
+    gboolean debug = cpdbDebugEnabled(CPDB_DEBUG_LEVEL_DEBUG);
+    gint64 start = cpdbTraceStart();
+
+    /* The arrays may come from the options cache, so their sizes
+     * are taken from the arrays themselves and not from the counts */
+    i = 0;
     g_variant_get(opts_var, "a(sssia(s))", &iter);
-    for (i = 0; i < num_options; i++)
-    {
-        opt = g_new0(cpdb_option_t, 1);
-        g_variant_iter_loop(iter, "(sssia(s))",
-                            &name, &group, &def, &num, &sub_iter);
-
-        logdebug("name=%s;\n", name);
-        opt->option_name = cpdbGetStringCopy(name);
-        logdebug("group=%s;\n", group);
-        opt->group_name = cpdbGetStringCopy(group);
-        logdebug("default=%s;\n", def);
-        opt->default_value = cpdbGetStringCopy(def);
-        logdebug("num_choices=%d;\n", num);
+    while (g_variant_iter_loop(iter, "(&s&s&sia(s))",
+                               &name, &group, &def, &num, &sub_iter))
+    {
+        priv = cpdbArenaAlloc(options->arena, sizeof(cpdb_option_priv_t));
+        opt = &priv->option;
+        num = g_variant_iter_n_children(sub_iter);
+        i++;
+
+        if (debug)
+        {
+            logdebug("name=%s;\n", name);
+            logdebug("group=%s;\n", group);
+            logdebug("default=%s;\n", def);
+            logdebug("num_choices=%d;\n", num);
+            logdebug("choices:\n");
+        }
+        opt->option_name = cpdbInternString(name);
+        opt->group_name = cpdbInternString(group);
+        opt->default_value = cpdbInternString(def);
         opt->num_supported = num;
-        logdebug("choices:\n");
-        opt->supported_values = cpdbNewCStringArray(num);
-        for (j = 0; j < num; j++)
+        opt->supported_values = cpdbArenaAlloc(options->arena, sizeof(char *) * num);
+        j = 0;
+        while (g_variant_iter_loop(sub_iter, "(&s)", &str))
         {
-            g_variant_iter_loop(sub_iter, "(s)", &str);
-            logdebug("  %s;\n", str);
-            opt->supported_values[j] = cpdbGetStringCopy(str);
+            if (debug)
+                logdebug("  %s;\n", str);
+            opt->supported_values[j++] = cpdbInternString(str);
         }
-        g_hash_table_insert(options->table, cpdbGetStringCopy(opt->option_name), opt);
+        priv->choice_index = cpdbIndexChoices(options->arena, opt->supported_values, num);
+        if ((old_opt = g_hash_table_lookup(options->table, opt->option_name)) != NULL)
+            cpdbReleaseOption(old_opt);
+        g_hash_table_replace(options->table, opt->option_name, opt);
     }
+    g_variant_iter_free(iter);
+    if (i != num_options)
+        logwarn("Expected %d options, got %d\n", num_options, i);
+    options->count = i;
     
-    options->media_count = num_media;
+    i = 0;
     g_variant_get(media_var, "a(siiia(iiii))", &iter);
-    for (i = 0; i < num_media; i++)
+    while (g_variant_iter_loop(iter, "(&siiia(iiii))",
+                               &name, &width, &length, &num, &sub_iter))
     {
-		media = g_new0(cpdb_media_t, 1);
-		g_variant_iter_loop(iter, "(siiia(iiii))",
-							&name, &width, &length, &num, &sub_iter);
-        
-        logdebug("name=%s;\n", name);
-		media->name = cpdbGetStringCopy(name);
-        logdebug("width=%d;\n", width);
+		media = cpdbArenaAlloc(options->arena, sizeof(cpdb_media_t));
+        num = g_variant_iter_n_children(sub_iter);
+        i++;
+
+        if (debug)
+        {
+            logdebug("name=%s;\n", name);
+            logdebug("width=%d;\n", width);
+            logdebug("length=%d;\n", length);
+            logdebug("num_margins=%d;\n", num);
+        }
+		media->name = cpdbInternString(name);
 		media->width = width;
-        logdebug("length=%d;\n", length);
 		media->length = length;
-        logdebug("num_margins=%d;\n", num);
 		media->num_margins = num;
-		media->margins = g_new0(cpdb_margin_t, num);
-		for (j = 0; j < num; j++)
+		media->margins = cpdbArenaAlloc(options->arena, sizeof(cpdb_margin_t) * num);
+		j = 0;
+		while (g_variant_iter_loop(sub_iter, "(iiii)", &l, &r, &t, &b))
 		{
-			g_variant_iter_loop(sub_iter, "(iiii)", &l, &r, &t, &b);
-            logdebug("    %d,%d,%d,%d;\n", l, r, t, b);
+            if (debug)
+                logdebug("    %d,%d,%d,%d;\n", l, r, t, b);
 			media->margins[j].left = l;
             media->margins[j].right = r;
             media->margins[j].top = t; 
             media->margins[j].bottom = b;
+            j++;
 		}
-		g_hash_table_insert(options->media, cpdbGetStringCopy(media->name), media);
+		if ((old_media = g_hash_table_lookup(options->media, media->name)) != NULL)
+			cpdbReleaseString(old_media->name);
+		g_hash_table_replace(options->media, media->name, media);
 	}
-    
+    g_variant_iter_free(iter);
+    if (i != num_media)
+        logwarn("Expected %d media, got %d\n", num_media, i);
+    options->media_count = i;
+
+    cpdbTraceComplete(CPDB_TRACE_UNPACK, "UnpackOptions", NULL, start, options->count,
+                      g_variant_get_size(opts_var) + g_variant_get_size(media_var));
 }
 
 static GHashTable *cpdbUnpackTranslations (GVariant *variant)
@@ -2118,12 +6126,14 @@ static GHashTable *cpdbUnpackTranslations (GVariant *variant)
     GVariantIter iter;
     gchar *key, *value;
     GHashTable *translations;
+    gboolean debug = cpdbDebugEnabled(CPDB_DEBUG_LEVEL_DEBUG);
 
     translations = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, g_free);
     g_variant_iter_init(&iter, variant);
     while (g_variant_iter_loop(&iter, CPDB_TL_ARGS, &key, &value))
     {
-        logdebug("Fetched translation '%s' : '%s'\n", key, value);
+        if (debug)
+            logdebug("Fetched translation '%s' : '%s'\n", key, value);
         g_hash_table_insert(translations,
                             cpdbGetStringCopy(key), cpdbGetStringCopy(value));
     }
@@ -22,21 +22,39 @@ extern "C"
 /* Names of default config files */
 #define CPDB_PRINT_SETTINGS_FILE   "print-settings"
 #define CPDB_DEFAULT_PRINTERS_FILE "default-printers"
+#define CPDB_PRINTER_CACHE_FILE    "printer-cache"
 
-/* Debug macros */
-#define logdebug(...) cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_DEBUG, __VA_ARGS__)
-#define loginfo(...)  cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_INFO, __VA_ARGS__)
-#define logwarn(...)  cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_WARN, __VA_ARGS__)
-#define logerror(...) cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_ERROR, __VA_ARGS__)
+/* Bumped whenever the printer cache layout changes */
+#define CPDB_PRINTER_CACHE_VERSION 1
+
+/* Directory of the options cache in the user cache dir */
+#define CPDB_OPTIONS_CACHE_DIR      "options"
+#define CPDB_OPTIONS_CACHE_VERSION  1
+#define CPDB_OPTIONS_CACHE_ARGS     "(ussia(sssia(s))ia(siiia(iiii)))"
+
+/* Debug macros, the arguments aren't evaluated if the level is disabled */
+#define cpdbFLog(lvl, ...)  do { if (cpdbDebugEnabled(lvl)) cpdbFDebugPrintf(lvl, __VA_ARGS__); } while (0)
+#define logdebug(...) cpdbFLog(CPDB_DEBUG_LEVEL_DEBUG, __VA_ARGS__)
+#define loginfo(...)  cpdbFLog(CPDB_DEBUG_LEVEL_INFO, __VA_ARGS__)
+#define logwarn(...)  cpdbFLog(CPDB_DEBUG_LEVEL_WARN, __VA_ARGS__)
+#define logerror(...) cpdbFLog(CPDB_DEBUG_LEVEL_ERROR, __VA_ARGS__)
 
 typedef struct cpdb_frontend_obj_s cpdb_frontend_obj_t;
 typedef struct cpdb_printer_obj_s cpdb_printer_obj_t;
+typedef struct cpdb_printer_key_s cpdb_printer_key_t;
 typedef struct cpdb_settings_s cpdb_settings_t;
 typedef struct cpdb_options_s cpdb_options_t;
 typedef struct cpdb_option_s cpdb_option_t;
 typedef struct cpdb_margin_s cpdb_margin_t;
 typedef struct cpdb_media_s cpdb_media_t;
+typedef struct cpdb_options_view_s cpdb_options_view_t;
+typedef struct cpdb_option_view_s cpdb_option_view_t;
+typedef struct cpdb_media_view_s cpdb_media_view_t;
 typedef struct cpdb_job_s cpdb_job_t;
+typedef struct cpdb_call_stats_s cpdb_call_stats_t;
+typedef struct cpdb_prefetch_s cpdb_prefetch_t;
+typedef struct cpdb_violation_s cpdb_violation_t;
+typedef struct cpdb_translation_cache_s cpdb_translation_cache_t;
 
 typedef enum cpdb_printer_update_e {
     CPDB_CHANGE_PRINTER_ADDED,
@@ -44,6 +62,87 @@ typedef enum cpdb_printer_update_e {
     CPDB_CHANGE_PRINTER_STATE_CHANGED,
 } cpdb_printer_update_t;
 
+typedef enum cpdb_violation_type_e {
+    CPDB_VIOLATION_UNKNOWN_OPTION,      /** Not an option of the printer **/
+    CPDB_VIOLATION_UNSUPPORTED_VALUE,   /** Not among the supported values of the option **/
+    CPDB_VIOLATION_UNKNOWN_MEDIA,       /** Media without size information **/
+    CPDB_VIOLATION_UNSUPPORTED_MARGINS, /** Margins not supported with the media **/
+} cpdb_violation_type_t;
+
+/* Kinds of strings the backends translate */
+typedef enum cpdb_translation_kind_e {
+    CPDB_TRANSLATION_OPTION,
+    CPDB_TRANSLATION_CHOICE,
+    CPDB_TRANSLATION_GROUP,
+} cpdb_translation_kind_t;
+
+typedef enum cpdb_activation_mode_e {
+    CPDB_ACTIVATION_SEQUENTIAL,
+    CPDB_ACTIVATION_PARALLEL,
+} cpdb_activation_mode_t;
+
+/* Default deadline for parallel backend activation, in milliseconds */
+#define CPDB_ACTIVATION_TIMEOUT_DEFAULT 5000
+
+/* Default timeout for backend calls, i.e. the one of GDBus (25 s) */
+#define CPDB_CALL_TIMEOUT_DEFAULT -1
+
+/* Default delay before lazily registered backends are started anyway, -1 for never */
+#define CPDB_WARMUP_TIMEOUT_DEFAULT -1
+
+/* Default tolerance when matching media sizes, 5 points in hundredths of mm */
+#define CPDB_MEDIA_SIZE_TOLERANCE 176
+
+/* Default limits of the translations each printer keeps, see cpdbSetTranslationCacheLimits() */
+#define CPDB_TRANSLATION_CACHE_LOCALES  4
+#define CPDB_TRANSLATION_CACHE_SIZE     (1024 * 1024)
+
+/* Default number of printer details prefetched at once from each backend */
+#define CPDB_PREFETCH_IN_FLIGHT_DEFAULT 2
+
+/* Key of the frontend's GCancellable attached to the backend proxies */
+#define CPDB_PROXY_CANCELLABLE "cpdb-cancellable"
+
+/* Key of the call statistics of the backend attached to its proxy */
+#define CPDB_PROXY_CALL_STATS "cpdb-call-stats"
+
+/* Key set on the proxies of backends without GetAllOptionsBatch */
+#define CPDB_PROXY_NO_BATCH "cpdb-no-batch"
+
+/* Key set on placeholder proxies while their backend is being started */
+#define CPDB_PROXY_ACTIVATING "cpdb-activating"
+
+/* Keys of the options cache state attached to the backend proxies */
+#define CPDB_PROXY_OPTIONS_CACHE        "cpdb-options-cache"
+#define CPDB_PROXY_OPTIONS_REVISIONS    "cpdb-options-revisions"
+#define CPDB_PROXY_NO_REVISIONS         "cpdb-no-revisions"
+#define CPDB_PROXY_REVISIONS_WAITERS    "cpdb-revisions-waiters"
+
+/* Number of buckets of the call latency histograms */
+#define CPDB_LATENCY_BUCKETS 24
+
+/* Backend methods called by the frontend library */
+typedef enum cpdb_backend_method_e {
+    CPDB_METHOD_GET_PRINTER_LIST,
+    CPDB_METHOD_GET_DEFAULT_PRINTER,
+    CPDB_METHOD_GET_ALL_OPTIONS,
+    CPDB_METHOD_GET_ALL_OPTIONS_BATCH,
+    CPDB_METHOD_GET_OPTIONS_REVISIONS,
+    CPDB_METHOD_GET_ALL_TRANSLATIONS,
+    CPDB_METHOD_GET_OPTION_TRANSLATION,
+    CPDB_METHOD_GET_CHOICE_TRANSLATION,
+    CPDB_METHOD_GET_GROUP_TRANSLATION,
+    CPDB_METHOD_GET_PRINTER_STATE,
+    CPDB_METHOD_IS_ACCEPTING_JOBS,
+    CPDB_METHOD_GET_ACTIVE_JOBS_COUNT,
+    CPDB_METHOD_GET_ALL_JOBS,
+    CPDB_METHOD_PRINT_FILE,
+    CPDB_METHOD_CANCEL_JOB,
+    CPDB_METHOD_KEEP_ALIVE,
+    CPDB_METHOD_REPLACE,
+    CPDB_NUM_METHODS,
+} cpdb_backend_method_t;
+
 /**
  * Callback for printer updates
  * 
@@ -62,6 +161,25 @@ typedef void (*cpdb_printer_callback)(cpdb_frontend_obj_t *frontend_obj, cpdb_pr
  */
 typedef void (*cpdb_async_callback)(cpdb_printer_obj_t *printer_obj, int status, void *user_data);
 
+/**
+ * Callback for cpdbConnectToDBusAsync()
+ *
+ * @param frontend_obj      Frontend instance
+ * @param status            TRUE if all the backends answered,
+ *                          FALSE on error or if the activation timed out
+ * @param user_data         User data
+ */
+typedef void (*cpdb_connect_callback)(cpdb_frontend_obj_t *frontend_obj, int status, void *user_data);
+
+/**
+ * Callback for cpdbForEachTranslation()
+ *
+ * @param key               String key of the translation, like "OPT#name#choice"
+ * @param translation       Translated string
+ * @param user_data         User data
+ */
+typedef void (*cpdb_translation_callback)(const char *key, const char *translation, void *user_data);
+
 /*********************definitions ***************************/
 
 /**
@@ -69,6 +187,28 @@ ______________________________________ cpdb_frontend_obj_t _____________________
 
 **/
 
+/* Key of the printer table, pointing to the strings of the printer itself */
+struct cpdb_printer_key_s
+{
+    const char *id;
+    const char *backend_name;
+};
+
+/**
+ * Statistics of the calls to one backend method.
+ * Bucket i of the histogram counts the calls which took
+ * from 2^i to 2^(i+1) microseconds, the last one all the longer calls.
+ */
+struct cpdb_call_stats_s
+{
+    guint num_calls;
+    guint num_errors;       /** Failed calls, including the timeouts **/
+    guint num_timeouts;
+    gint64 total_time;      /** In microseconds **/
+    gint64 max_time;
+    guint histogram[CPDB_LATENCY_BUCKETS];
+};
+
 struct cpdb_frontend_obj_s
 {
     PrintFrontend *skeleton;
@@ -79,11 +219,33 @@ struct cpdb_frontend_obj_s
     char *bus_name;
     cpdb_printer_callback printer_cb;
 
+    cpdb_activation_mode_t activation_mode;
+    int activation_timeout;     /** Deadline for parallel activation in ms, -1 for none **/
+    int num_pending;            /** Number of backends still being activated **/
+    gboolean connecting;        /** TRUE while cpdbConnectToDBus() is blocking **/
+    GCancellable *cancellable;  /** Cancels the outstanding asynchronous calls **/
+    cpdb_connect_callback connect_cb;
+    void *connect_user_data;
+    GSource *connect_timeout;
+    int call_timeout;               /** Timeout for backend calls in ms **/
+    GHashTable *backend_timeouts;   /**[backend name] --> [timeout in ms] **/
+    gboolean lazy_activation;   /** Don't start backends which aren't running yet **/
+    int warmup_timeout;         /** Delay before starting them anyway in ms, -1 for never **/
+    GSource *warmup_source;
+    gboolean use_printer_cache;
+    GHashTable *cached_printers;    /**[cpdb_printer_key_t] --> [cpdb_printer_obj_t] of cached printers not seen live yet **/
+    GHashTable *call_stats;         /**[backend name] --> call statistics of each method **/
+    GMutex call_stats_lock;         /** Guards call_stats, which is read from other threads **/
+    cpdb_prefetch_t *prefetch;      /** Printer details acquired in the background, NULL if disabled **/
+    gboolean use_options_cache;
+    int translation_cache_locales;  /** Limits applied to the translation cache of the printers **/
+    gsize translation_cache_size;
+
     int num_backends;
     GHashTable *backend; /**[backend name(like "CUPS" or "GCP")] ---> [BackendObj]**/
 
     int num_printers;
-    GHashTable *printer; /**[printer name] --> [cpdb_printer_obj_t] **/
+    GHashTable *printer; /**[cpdb_printer_key_t] --> [cpdb_printer_obj_t] **/
 
     cpdb_settings_t *last_saved_settings; /** The last saved settings to disk */
 };
@@ -113,6 +275,153 @@ void cpdbDeleteFrontendObj(cpdb_frontend_obj_t *frontend_obj);
  */
 void cpdbConnectToDBus(cpdb_frontend_obj_t *frontend_obj);
 
+/**
+ * Connect to DBus, activate the CPDB backends and fetch printers
+ * without blocking.
+ *
+ * Returns immediately. The backends are activated in parallel
+ * (see cpdbSetActivationMode()) from the thread-default main context,
+ * and every printer is reported through the printer callback with
+ * CPDB_CHANGE_PRINTER_ADDED as soon as its backend answers.
+ * connect_cb is called once all the backends have answered
+ * or the activation timeout has expired.
+ *
+ * @param frontend_obj      Frontend instance to connect to DBus
+ * @param connect_cb        Completion callback, can be NULL
+ * @param user_data         User data to pass to the callback
+ */
+void cpdbConnectToDBusAsync(cpdb_frontend_obj_t *frontend_obj, cpdb_connect_callback connect_cb, void *user_data);
+
+/**
+ * Choose how cpdbConnectToDBus() activates the backends.
+ *
+ * With CPDB_ACTIVATION_SEQUENTIAL (the default) each backend is activated
+ * and queried for its printers one after the other.
+ * With CPDB_ACTIVATION_PARALLEL all backends are activated and queried
+ * concurrently, and cpdbConnectToDBus() returns once every backend has
+ * answered or the timeout has expired. Printers of backends answering
+ * after that are reported through the printer callback.
+ *
+ * Must be called before cpdbConnectToDBus().
+ *
+ * @param frontend_obj      Frontend instance
+ * @param mode              Activation mode
+ * @param timeout           Deadline for parallel activation in milliseconds,
+ *                          or -1 to wait for all the backends
+ */
+void cpdbSetActivationMode(cpdb_frontend_obj_t *frontend_obj, cpdb_activation_mode_t mode, int timeout);
+
+/**
+ * Choose whether cpdbConnectToDBus() starts the backends which
+ * are installed but not running.
+ *
+ * In lazy mode such backends are only registered, and get started
+ * when their printers are first asked for, by cpdbGetDefaultPrinter(),
+ * cpdbGetDefaultPrinterForBackend() or cpdbActivateBackend(),
+ * in the background by cpdbFindPrinterObj(),
+ * or when the warm-up timeout expires after connecting.
+ * Their printers are then reported through the printer callback.
+ *
+ * Must be called before cpdbConnectToDBus().
+ *
+ * @param frontend_obj      Frontend instance
+ * @param lazy              TRUE to defer starting the backends
+ * @param warmup_timeout    Delay in milliseconds after which the deferred
+ *                          backends are started in the background,
+ *                          or -1 to only start them on demand
+ */
+void cpdbSetLazyActivation(cpdb_frontend_obj_t *frontend_obj, gboolean lazy, int warmup_timeout);
+
+/**
+ * Start a backend registered by the lazy activation mode
+ * and fetch its printers. Does nothing if it is already running.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param backend_name      Backend name
+ *
+ * @return                  TRUE if the backend is running, FALSE otherwise
+ */
+gboolean cpdbActivateBackend(cpdb_frontend_obj_t *frontend_obj, const char *backend_name);
+
+/**
+ * Set the timeout of the calls made to the backends.
+ * A backend which doesn't answer in time is treated as unavailable
+ * for that call, instead of blocking the caller for the D-Bus default
+ * of 25 seconds. Overridden by cpdbSetBackendCallTimeout().
+ *
+ * @param frontend_obj      Frontend instance
+ * @param timeout           Timeout in milliseconds,
+ *                          or CPDB_CALL_TIMEOUT_DEFAULT
+ */
+void cpdbSetCallTimeout(cpdb_frontend_obj_t *frontend_obj, int timeout);
+
+/**
+ * Set the timeout of the calls made to a particular backend.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param backend_name      Backend name
+ * @param timeout           Timeout in milliseconds,
+ *                          or CPDB_CALL_TIMEOUT_DEFAULT
+ */
+void cpdbSetBackendCallTimeout(cpdb_frontend_obj_t *frontend_obj, const char *backend_name, int timeout);
+
+/**
+ * Cancel all the calls to the backends still in progress,
+ * including the ones made for the printers of this frontend instance.
+ * Cancelled calls fail as if the backend was unavailable.
+ * A pending cpdbConnectToDBusAsync() completes with status FALSE,
+ * a pending warm-up of lazily registered backends is dropped,
+ * and prefetching stops until the next connection.
+ *
+ * @param frontend_obj      Frontend instance
+ */
+void cpdbCancelPendingCalls(cpdb_frontend_obj_t *frontend_obj);
+
+/**
+ * Get the D-Bus name of a backend method, like "GetAllOptions".
+ */
+const char *cpdbGetBackendMethodName(cpdb_backend_method_t method);
+
+/**
+ * Get the statistics of the calls made to a backend method
+ * since the backend was found or the statistics were reset.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param backend_name      Backend name
+ * @param method            Backend method
+ * @param stats             Filled with a copy of the statistics
+ *
+ * @return                  FALSE if the backend isn't known
+ */
+gboolean cpdbGetCallStats(cpdb_frontend_obj_t *frontend_obj, const char *backend_name,
+                          cpdb_backend_method_t method, cpdb_call_stats_t *stats);
+
+/**
+ * Estimate a latency percentile from the histogram of call statistics.
+ *
+ * @param stats             Call statistics
+ * @param percentile        Between 0 and 100
+ *
+ * @return                  Upper bound of the percentile in microseconds,
+ *                          0 if there were no calls
+ */
+gint64 cpdbGetCallLatencyPercentile(const cpdb_call_stats_t *stats, double percentile);
+
+/**
+ * Reset the call statistics of all the backends.
+ *
+ * @param frontend_obj      Frontend instance
+ */
+void cpdbResetCallStats(cpdb_frontend_obj_t *frontend_obj);
+
+/**
+ * Print a table of the call statistics of each backend.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param out               Output stream
+ */
+void cpdbPrintCallStats(cpdb_frontend_obj_t *frontend_obj, FILE *out);
+
 /**
  * Disconnect from the DBus.
  * 
@@ -135,10 +444,85 @@ void cpdbDisconnectFromDBus(cpdb_frontend_obj_t *frontend_obj);
 void cpdbIgnoreLastSavedSettings(cpdb_frontend_obj_t *frontend_obj);
 
 /**
- * Add the printer to the frontend instance
- * 
+ * Keep the printer list in CPDB_PRINTER_CACHE_FILE in the user config dir.
+ *
+ * When connecting, the printers found the last time are added right away,
+ * and then checked against what each backend reports: cached printers
+ * still present are updated in place (CPDB_CHANGE_PRINTER_STATE_CHANGED
+ * if any basic attribute changed), new ones are reported with
+ * CPDB_CHANGE_PRINTER_ADDED and gone ones with CPDB_CHANGE_PRINTER_REMOVED.
+ * The cache is written when disconnecting.
+ *
+ * Must be called before cpdbConnectToDBus().
+ *
+ * @param frontend_obj      Frontend instance
+ * @param use               TRUE to use the printer cache
+ */
+void cpdbUsePrinterCache(cpdb_frontend_obj_t *frontend_obj, gboolean use);
+
+/**
+ * Keep the options of the printers in CPDB_OPTIONS_CACHE_DIR in the
+ * user cache dir, shared by all the frontends of the user.
+ *
+ * Cached options are used instead of calling the backend as long as
+ * the options revision reported by the backend for the printer matches.
+ * The revisions of all the printers of a backend are fetched with one
+ * call when first needed, asynchronously for cpdbAcquireDetails(), and
+ * again after a printer of that backend was added or removed.
+ * Backends which don't report revisions aren't cached.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param use               TRUE to use the options cache
+ */
+void cpdbUseOptionsCache(cpdb_frontend_obj_t *frontend_obj, gboolean use);
+
+/**
+ * Set how many translations each printer keeps.
+ *
+ * Printers keep the translations of the locales last fetched, so that
+ * switching back to one of them doesn't call the backend again.
+ * The least recently used locales are dropped once there are more than
+ * max_locales, or their strings take up more than max_size bytes.
+ * The most recently used locale is always kept.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param max_locales       Number of locales kept, CPDB_TRANSLATION_CACHE_LOCALES by default
+ * @param max_size          Approximate size of the translations kept, in bytes,
+ *                          CPDB_TRANSLATION_CACHE_SIZE by default
+ */
+void cpdbSetTranslationCacheLimits(cpdb_frontend_obj_t *frontend_obj,
+                                   int max_locales,
+                                   gsize max_size);
+
+/**
+ * Acquire the details of the printers in the background, as with
+ * cpdbAcquireDetails(), once connected to DBus: the default printer
+ * first, then the other configured default printers, then the rest,
+ * including printers added later on.
+ * Printers of lazily registered backends are skipped until they are started.
+ *
+ * @param frontend_obj      Frontend instance
+ * @param prefetch          TRUE to prefetch the printer details
+ * @param max_in_flight     Maximum number of requests to a backend at once,
+ *                          or CPDB_PREFETCH_IN_FLIGHT_DEFAULT if <= 0
+ */
+void cpdbSetPrefetch(cpdb_frontend_obj_t *frontend_obj, gboolean prefetch, int max_in_flight);
+
+/**
+ * Move a printer to the front of the prefetch queue,
+ * e.g. when it is about to be selected.
+ *
  * @param frontend_obj      Frontend instance
  * @param printer_obj       Printer object
+ */
+void cpdbPrioritizePrefetch(cpdb_frontend_obj_t *frontend_obj, cpdb_printer_obj_t *printer_obj);
+
+/**
+ * Add the printer to the frontend instance.
+ * A printer with the same id and backend which is already known isn't replaced.
+ * 
+ * @param frontend_obj      Frontend instance
+ * @param printer_obj       Printer object, owned by the frontend instance on success
  * 
  * @return                  Success status
  */
@@ -198,6 +582,10 @@ PrintBackend *cpdbCreateBackend(GDBusConnection *, const char *);
 /**
  * Find the cpdb_printer_obj_t instance with a particular id and backend name.
  * 
+ * If the backend was registered lazily and isn't running yet, it is started
+ * in the background and NULL is returned. Its printers are then reported
+ * through the printer callback. cpdbActivateBackend() waits for them instead.
+ * 
  * @param frontend_obj      Frontend instance
  * @param printer_id        Printer ID
  * @param backend_name      Backend name
@@ -255,6 +643,15 @@ gboolean cpdbSetSystemDefaultPrinter(cpdb_printer_obj_t *p);
  */
 int cpdbGetAllJobs(cpdb_frontend_obj_t *frontend_obj, cpdb_job_t **jobs, gboolean active_only);
 
+/**
+ * Free up a job list obtained from cpdbGetAllJobs(),
+ * releasing the interned backend names.
+ *
+ * @param jobs              cpdb_job_t array
+ * @param num_jobs          Length of the array
+ */
+void cpdbDeleteJobs(cpdb_job_t *jobs, int num_jobs);
+
 /*******************************************************************************************/
 
 /**
@@ -264,7 +661,7 @@ ______________________________________ cpdb_printer_obj_t ______________________
 struct cpdb_printer_obj_s
 {
     PrintBackend *backend_proxy; /** The proxy object of the backend the printer is associated with **/
-    char *backend_name;          /** Backend name ,("CUPS"/ "GCP") also used as suffix */
+    char *backend_name;          /** Backend name ,("CUPS"/ "GCP") also used as suffix, interned **/
 
     /**The basic attributes first**/
 
@@ -282,20 +679,30 @@ struct cpdb_printer_obj_s
     /**The settings the user selects, and which will be used for printing the job**/
     cpdb_settings_t *settings;
 
-    /** Translations **/
+    /**
+     * Translations of the most recently used locale, owned by the translation cache.
+     * They change whenever another locale gets used, so only read them from
+     * the thread using the translations, or use cpdbForEachTranslation().
+     */
     char *locale;
     GHashTable *translations;
+    cpdb_translation_cache_t *translation_cache;
 };
 
 /**
  * Get a new empty printer object.
  * 
+ * Its backend_name must be set with cpdbInternString(), not
+ * with a string from malloc(), since cpdbDeletePrinterObj()
+ * releases it with cpdbReleaseString().
+ * 
  * @return                  Printer object
  */
 cpdb_printer_obj_t *cpdbGetNewPrinterObj();
 
 /**
  * Free up a printer object.
+ * The backend name is released with cpdbReleaseString(), never free()d.
  * 
  * @param printer_obj       Printer object
  */
@@ -335,6 +742,22 @@ char *cpdbGetState(cpdb_printer_obj_t *printer_obj);
  */
 cpdb_options_t *cpdbGetAllOptions(cpdb_printer_obj_t *printer_obj);
 
+/**
+ * Get a read-only view of the options and media supported by a printer,
+ * for callers which only display them.
+ *
+ * Unlike cpdbGetAllOptions(), nothing is copied: the strings of the view
+ * point into the reply of the backend, or into the mapped options cache,
+ * which the view keeps alive. The view isn't kept by the printer object,
+ * every call gets a new one.
+ *
+ * @param printer_obj       Printer object
+ *
+ * @return                  Options view, to be freed with cpdbDeleteOptionsView(),
+ *                          NULL on error
+ */
+cpdb_options_view_t *cpdbGetOptionsView(cpdb_printer_obj_t *printer_obj);
+
 /**
  * Get a single cpdb_option_t struct corresponding to an option name for a printer.
  *
@@ -427,6 +850,29 @@ void cpdbAddSettingToPrinter(cpdb_printer_obj_t *printer_obj, const char *option
  */
 gboolean cpdbClearSettingFromPrinter(cpdb_printer_obj_t *printer_obj, const char *option_name);
 
+/**
+ * Check settings against the options and media supported by a printer,
+ * without calling the backend once the options are known.
+ * All the violations are reported, not just the first one.
+ *
+ * Values are checked against the supported values of their option,
+ * unless it has none, i.e. takes any value. The margins set are checked
+ * against the ones supported with the media set, or the default media.
+ * Settings of options unknown to the printer are reported as
+ * CPDB_VIOLATION_UNKNOWN_OPTION, which callers passing extra
+ * attributes to the backend may want to ignore.
+ *
+ * @param printer_obj       Printer object
+ * @param settings          Settings to check, or NULL for the settings of the printer
+ * @param violations        Set to the violations found, to be freed with
+ *                          cpdbDeleteViolations(), NULL if none
+ *
+ * @return                  Number of violations, -1 if the options couldn't be obtained
+ */
+int cpdbValidateSettings(cpdb_printer_obj_t *printer_obj,
+                         cpdb_settings_t *settings,
+                         cpdb_violation_t **violations);
+
 /**
  * Cancel a job on a printer.
  *
@@ -494,6 +940,25 @@ char *cpdbGetChoiceTranslation(cpdb_printer_obj_t *printer_obj, const char *opti
  */
 char *cpdbGetGroupTranslation(cpdb_printer_obj_t *printer_obj, const char *group_name, const char *lang);
 
+/**
+ * Get the translation of a string provided by a printer, as with
+ * cpdbGetOptionTranslation(), cpdbGetChoiceTranslation() and cpdbGetGroupTranslation().
+ * Cached translations are looked up by kind and names, without building a key.
+ *
+ * @param printer_obj       Printer object
+ * @param kind              Kind of string
+ * @param name              Option name, or group name for CPDB_TRANSLATION_GROUP
+ * @param choice            Option value for CPDB_TRANSLATION_CHOICE, NULL otherwise
+ * @param lang              BCP47 language tag to be used for translation
+ *
+ * @return                  Translated string
+ */
+char *cpdbGetTranslation(cpdb_printer_obj_t *printer_obj,
+                         cpdb_translation_kind_t kind,
+                         const char *name,
+                         const char *choice,
+                         const char *lang);
+
 
 /**
  * Get translations for all strings provided by a printer.
@@ -503,6 +968,22 @@ char *cpdbGetGroupTranslation(cpdb_printer_obj_t *printer_obj, const char *group
  */
 void cpdbGetAllTranslations(cpdb_printer_obj_t *printer_obj, const char *lang);
 
+/**
+ * Call a function for each cached translation of a printer in a locale,
+ * with the translation cache locked, so that it is safe from any thread.
+ * The function must not call back into the translation functions.
+ *
+ * @param printer_obj       Printer object
+ * @param lang              BCP47 language tag of the translations,
+ *                          NULL for the most recently used one
+ * @param func              Function called for each translation
+ * @param user_data         User data to pass to func
+ *
+ * @return                  FALSE if no translations of the locale are cached
+ */
+gboolean cpdbForEachTranslation(cpdb_printer_obj_t *printer_obj, const char *lang,
+                                cpdb_translation_callback func, void *user_data);
+
 /**
  * Get the cpdb_media_t struct corresponding to a media-size supported by a printer.
  *
@@ -536,6 +1017,25 @@ int cpdbGetMediaSize(cpdb_printer_obj_t *printer_obj, const char *media_name, in
  */
 int cpdbGetMediaMargins(cpdb_printer_obj_t *printer_obj, const char *media_name, cpdb_margin_t **margins);
 
+/**
+ * Find the media-size supported by a printer which best matches a page size,
+ * in either orientation.
+ *
+ * The closest media-size within the tolerance is preferred. Failing that,
+ * the smallest media-size the page fits on is returned.
+ * Media-sizes are indexed by dimensions the first time, so looking up
+ * many pages only costs a binary search each.
+ *
+ * @param printer_obj       Printer object
+ * @param width             Page width, in hundredths of mm
+ * @param length            Page length, in hundredths of mm
+ * @param tolerance         Largest difference of each side to be considered the same
+ *                          size, or -1 for CPDB_MEDIA_SIZE_TOLERANCE
+ *
+ * @return                  Media struct, NULL if the page fits on no media-size
+ */
+cpdb_media_t *cpdbGetMediaForSize(cpdb_printer_obj_t *printer_obj, int width, int length, int tolerance);
+
 /**
  * Asynchronously fetch printer details and options.
  *
@@ -546,6 +1046,20 @@ int cpdbGetMediaMargins(cpdb_printer_obj_t *printer_obj, const char *media_name,
  */
 void cpdbAcquireDetails(cpdb_printer_obj_t *printer_obj, cpdb_async_callback caller_cb, void *user_data);
 
+/**
+ * Asynchronously fetch the details and options of several printers,
+ * with a single call to each backend.
+ * With backends not supporting that, all the printers' requests
+ * are sent at once instead, as with cpdbAcquireDetails().
+ *
+ * @param printer_objs      Printer objects
+ * @param num_printers      Number of printer objects
+ * @param caller_cb         Callback function, called once for each printer
+ * @param user_data         User data to pass to callback function
+ */
+void cpdbAcquireDetailsBatch(cpdb_printer_obj_t **printer_objs, int num_printers,
+                             cpdb_async_callback caller_cb, void *user_data);
+
 /**
  * Asynchronously fetch all printer strings translations,
  * which can then be obtained using cpdbGet[...]Translation() functions.
@@ -640,28 +1154,59 @@ cpdb_settings_t *cpdbReadSettingsFromDisk();
  */
 void cpdbDeleteSettings(cpdb_settings_t *settings_obj);
 
+/************************************************************************************************/
+/**
+______________________________________ cpdb_violation_t __________________________________________
+
+**/
+struct cpdb_violation_s
+{
+    cpdb_violation_type_t type;
+    char *option_name;      /** Interned, see cpdbInternString() **/
+    char *value;            /** Interned, see cpdbInternString() **/
+};
+
+/**
+ * Free up the violations found by cpdbValidateSettings().
+ *
+ * @param violations        Array of violations
+ * @param num_violations    Number of violations
+ */
+void cpdbDeleteViolations(cpdb_violation_t *violations, int num_violations);
+
 /************************************************************************************************/
 /**
 ______________________________________ cpdb_options_t __________________________________________
 
 **/
+/**
+ * The options and media in the tables, with their arrays, are allocated
+ * from the arena and freed along with it by cpdbDeleteOptions(), which
+ * also releases their interned strings. They must not be deleted one by one.
+ */
 struct cpdb_options_s
 {
     int count;
     int media_count;
     GHashTable *table; /**[name] --> cpdb_option_t struct**/
     GHashTable *media; /**[name] --> cpdb_media_t struct**/
+    cpdb_arena_t *arena; /** Memory of the options and media in the tables **/
 };
 
 /**
- * Get an empty cpdb_options_t struct with no 'options' in it
+ * Get an empty cpdb_options_t struct with no 'options' in it.
+ * The options and media added to its tables, and their arrays, must be
+ * allocated with cpdbArenaAlloc() from its arena, and their strings
+ * interned with cpdbInternString(). They are freed along with it.
+ * Options objects must only be obtained from here, the library
+ * keeps private state along with them.
  * 
  * @return                  Options object
  */
 cpdb_options_t *cpdbGetNewOptions();
 
 /**
- * Free up an options object.
+ * Free up an options object, with all the options and media in it.
  * 
  * @param options           Options object
  */
@@ -672,6 +1217,11 @@ void cpdbDeleteOptions(cpdb_options_t *);
 ______________________________________ cpdb_option_t __________________________________________
 
 **/
+/**
+ * All the strings of options and media are interned, see cpdbInternString().
+ * They are released with cpdbReleaseString() and must never be free()d,
+ * options and media built by the caller have to intern them as well.
+ */
 struct cpdb_option_s
 {
     char *option_name;
@@ -682,10 +1232,42 @@ struct cpdb_option_s
 };
 
 /**
+ * Free up an option allocated by the caller with malloc(),
+ * with its supported_values array, releasing its interned strings.
+ * The options of a cpdb_options_t, e.g. from cpdbGetOption(),
+ * belong to it and must not be deleted with this.
+ *
  * @param opt               Option object
  */
 void cpdbDeleteOption(cpdb_option_t *);
 
+/**
+ * Find a choice among the supported values of an option.
+ * The options of an options object obtained from a backend are indexed,
+ * making it a binary search.
+ *
+ * @param opts              Options object the option belongs to,
+ *                          NULL for an option built by the caller
+ * @param opt               Option object
+ * @param choice            Choice to find
+ *
+ * @return                  Index of the first matching value in supported_values,
+ *                          -1 if not supported
+ */
+int cpdbGetChoiceIndex(const cpdb_options_t *opts, const cpdb_option_t *opt,
+                       const char *choice);
+
+/**
+ * Check if a choice is among the supported values of an option.
+ *
+ * @param opts              Options object the option belongs to,
+ *                          NULL for an option built by the caller
+ * @param opt               Option object
+ * @param choice            Choice to check
+ */
+gboolean cpdbIsChoiceSupported(const cpdb_options_t *opts, const cpdb_option_t *opt,
+                               const char *choice);
+
 /************************************************************************************************/
 
 /**
@@ -709,7 +1291,7 @@ ______________________________________ cpdb_media_t ____________________________
 
 struct cpdb_media_s
 {
-    char *name;
+    char *name;             /** Interned, see cpdb_option_t **/
     int width;
     int length;
     int num_margins;
@@ -717,12 +1299,111 @@ struct cpdb_media_s
 };
 
 /**
- * Free up a media-size object.
+ * Free up a media-size object allocated by the caller with malloc(),
+ * with its margins, releasing its interned name.
+ * The media of a cpdb_options_t belong to it and must not be deleted with this.
  * 
  * @param media             Media-size object
  */
 void cpdbDeleteMedia(cpdb_media_t *media);
 
+/************************************************************************************************/
+/**
+______________________________________ cpdb_options_view_t __________________________________________
+
+**/
+struct cpdb_option_view_s
+{
+    const char *option_name;
+    const char *group_name;
+    int num_supported;
+    const char **supported_values;
+    const char *default_value;
+};
+
+struct cpdb_media_view_s
+{
+    const char *name;
+    int width;
+    int length;
+    int num_margins;
+    const cpdb_margin_t *margins;
+};
+
+/**
+ * Get a view of serialized options, in the format of the GetAllOptions reply.
+ * The variants are referenced by the view, not copied.
+ *
+ * @param options_var       Options, of type a(sssia(s))
+ * @param media_var         Media, of type a(siiia(iiii))
+ *
+ * @return                  Options view
+ */
+cpdb_options_view_t *cpdbGetNewOptionsView(GVariant *options_var,
+                                           GVariant *media_var);
+
+/**
+ * Get the number of options in a view.
+ */
+int cpdbGetOptionsViewCount(const cpdb_options_view_t *view);
+
+/**
+ * Get an option of a view, in the order sent by the backend.
+ *
+ * @param view              Options view
+ * @param index             Index of the option, from 0 to cpdbGetOptionsViewCount() - 1
+ *
+ * @return                  Option, valid as long as the view, NULL if out of range
+ */
+const cpdb_option_view_t *cpdbGetOptionViewAt(const cpdb_options_view_t *view,
+                                              int index);
+
+/**
+ * Find an option of a view by name.
+ *
+ * @param view              Options view
+ * @param name              Option name
+ *
+ * @return                  Option, valid as long as the view, NULL if not found
+ */
+const cpdb_option_view_t *cpdbLookupOptionView(const cpdb_options_view_t *view,
+                                               const char *name);
+
+/**
+ * Get the number of media in a view.
+ */
+int cpdbGetMediaViewCount(const cpdb_options_view_t *view);
+
+/**
+ * Get a media of a view, in the order sent by the backend.
+ *
+ * @param view              Options view
+ * @param index             Index of the media, from 0 to cpdbGetMediaViewCount() - 1
+ *
+ * @return                  Media, valid as long as the view, NULL if out of range
+ */
+const cpdb_media_view_t *cpdbGetMediaViewAt(const cpdb_options_view_t *view,
+                                            int index);
+
+/**
+ * Find a media of a view by name.
+ *
+ * @param view              Options view
+ * @param name              Media name
+ *
+ * @return                  Media, valid as long as the view, NULL if not found
+ */
+const cpdb_media_view_t *cpdbLookupMediaView(const cpdb_options_view_t *view,
+                                             const char *name);
+
+/**
+ * Free up an options view, along with all the options
+ * and media obtained from it.
+ *
+ * @param view              Options view
+ */
+void cpdbDeleteOptionsView(cpdb_options_view_t *view);
+
 /************************************************************************************************/
 /**
 ______________________________________ cpdb_job_t __________________________________________
@@ -733,7 +1414,7 @@ struct cpdb_job_s
     char *job_id;
     char *title;
     char *printer_id;
-    char *backend_name;
+    char *backend_name;     /** Interned, released by cpdbDeleteJobs(), never free()d **/
     char *user;
     char *state;
     char *submitted_at;
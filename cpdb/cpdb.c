@@ -6,48 +6,66 @@
 volatile gboolean initialized = FALSE;
 
 /**
- * Table matching common IPP options prefix to groups
+ * Lowest level of the messages logged
  */
-const char *cpdbGroupTable[][2] = {
-
-    {CPDB_OPTION_COPIES,                        CPDB_GROUP_COPIES},
-    {CPDB_OPTION_COLLATE,                       CPDB_GROUP_COPIES}, 
-    {CPDB_OPTION_COPIES_SUPPORTED,              CPDB_GROUP_COPIES},
-
-    {CPDB_OPTION_MEDIA,                         CPDB_GROUP_MEDIA},
-    {CPDB_OPTION_MEDIA_TYPE,                    CPDB_GROUP_MEDIA},
-
-    {CPDB_OPTION_SIDES,                         CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_MIRROR,                        CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_BOOKLET,                       CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_PAGE_SET,                      CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_NUMBER_UP,                     CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_PAGE_BORDER,                   CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_PAGE_RANGES,                   CPDB_GROUP_PAGE_MGMT},
-    {CPDB_OPTION_ORIENTATION,                   CPDB_GROUP_PAGE_MGMT},
-
-    {CPDB_OPTION_POSITION,                      CPDB_GROUP_SCALING},
-    {CPDB_OPTION_PRINT_SCALING,                 CPDB_GROUP_SCALING},
-    {CPDB_OPTION_FIDELITY,                      CPDB_GROUP_SCALING},
-
-    {CPDB_OPTION_COLOR_MODE,                    CPDB_GROUP_COLOR},
-
-    {CPDB_OPTION_PRINT_QUALITY,                 CPDB_GROUP_QUALITY},
-    {CPDB_OPTION_RESOLUTION,                    CPDB_GROUP_QUALITY},
-    
-    {CPDB_OPTION_FINISHINGS,                    CPDB_GROUP_FINISHINGS},
-    {CPDB_OPTION_OUTPUT_BIN,                    CPDB_GROUP_FINISHINGS},
-    {CPDB_OPTION_PAGE_DELIVERY,                 CPDB_GROUP_FINISHINGS},
-
-    {CPDB_OPTION_JOB_NAME,                      CPDB_GROUP_JOB_MGMT},
-    {CPDB_OPTION_JOB_SHEETS,                    CPDB_GROUP_JOB_MGMT},
-    {CPDB_OPTION_JOB_PRIORITY,                  CPDB_GROUP_JOB_MGMT},
-    {CPDB_OPTION_BILLING_INFO,                  CPDB_GROUP_JOB_MGMT},
-    {CPDB_OPTION_JOB_HOLD_UNTIL,                CPDB_GROUP_JOB_MGMT}
-    
-};
+volatile gint cpdbDebugThreshold = -1;
+
+/**
+ * Log output, opened once from CPDB_DEBUG_LOGFILE
+ */
+static GMutex log_mutex;
+static FILE *log_file = NULL;
+static gboolean log_configured = FALSE;
+
+/**
+ * Bounded queue of the asynchronous log writer, lock-free for
+ * the threads logging: a slot is free for the producer at position
+ * pos when its sequence is pos, and filled when it is pos + 1
+ */
+typedef struct cpdb_log_record_s
+{
+    volatile gint sequence;
+    CpdbDebugLevel msg_lvl;
+    char msg[CPDB_BSIZE + 32];
+} cpdb_log_record_t;
+
+static cpdb_log_record_t log_queue[CPDB_LOG_QUEUE_SIZE];
+static volatile gint log_enqueue_pos = 0;
+static guint log_dequeue_pos = 0;
+static volatile gint log_dropped = 0;
+static volatile gint log_async = FALSE;
+static volatile gint log_producers = 0;    /** Loggers between checking log_async and queueing **/
+static volatile gint log_writer_waiting = FALSE;
+static GThread *log_writer = NULL;
+static GMutex log_writer_mutex;
+static GCond log_writer_cond;
+
+/**
+ * Trace ring buffer, trace_count events were recorded in total
+ */
+volatile gint cpdbTraceActive = FALSE;
+static GMutex trace_mutex;
+static cpdb_trace_event_t *trace_ring = NULL;
+static guint64 trace_count = 0;
+static GPrivate trace_thread;
+static volatile gint trace_num_threads = 0;
+
+/**
+ * Message catalogs of CPDB_GETTEXT_PACKAGE, loaded once per locale
+ */
+typedef struct cpdb_catalog_s
+{
+    GMappedFile *file;
+    GHashTable *messages;   /** [msgid] --> [msgstr], pointing into the file **/
+} cpdb_catalog_t;
+
+static GMutex catalog_mutex;
+static GHashTable *catalogs = NULL;    /** [locale] --> cpdb_catalog_t, NULL if none **/
 
 static void cpdbDebugLog(CpdbDebugLevel msg_lvl, const char *msg);
+static void cpdbConfigureLogging();
+static void cpdbWriteLog(CpdbDebugLevel msg_lvl, const char *msg);
+static void cpdbDumpTraceAtExit();
 
 
 void cpdbInit()
@@ -55,6 +73,18 @@ void cpdbInit()
     if (!initialized)
     {
         bindtextdomain(CPDB_GETTEXT_PACKAGE, CPDB_LOCALEDIR);
+        if (g_atomic_int_get(&cpdbDebugThreshold) < 0)
+            cpdbResolveDebugLevel();
+        g_mutex_lock(&log_mutex);
+        cpdbConfigureLogging();
+        g_mutex_unlock(&log_mutex);
+        if (getenv(CPDB_DEBUG_ASYNC))
+            cpdbSetAsyncLogging(TRUE);
+        if (getenv(CPDB_TRACE_FILE))
+        {
+            cpdbSetTracing(TRUE);
+            atexit(cpdbDumpTraceAtExit);
+        }
         initialized = TRUE;
     }
 }
@@ -113,6 +143,81 @@ char *cpdbGetStringCopy(const char *str)
     return s;
 }
 
+char *cpdbInternString(const char *str)
+{
+    if (str == NULL)
+        return NULL;
+    return g_ref_string_new_intern(str);
+}
+
+void cpdbReleaseString(char *str)
+{
+    if (str == NULL)
+        return;
+    g_ref_string_release(str);
+}
+
+typedef struct cpdb_arena_block_s
+{
+    struct cpdb_arena_block_s *next;
+    size_t size;
+    size_t used;
+    char data[];
+} cpdb_arena_block_t;
+
+struct cpdb_arena_s
+{
+    cpdb_arena_block_t *head;
+    size_t block_size;
+};
+
+cpdb_arena_t *cpdbNewArena(size_t block_size)
+{
+    cpdb_arena_t *arena = g_new0(cpdb_arena_t, 1);
+
+    arena->head = NULL;
+    arena->block_size = block_size ? block_size : CPDB_ARENA_BLOCK_SIZE;
+    return arena;
+}
+
+void *cpdbArenaAlloc(cpdb_arena_t *arena, size_t size)
+{
+    void *mem;
+    size_t block_size;
+    cpdb_arena_block_t *block = arena->head;
+
+    /* The block header keeps the data pointer aligned */
+    size = (size + sizeof(void *) - 1) & ~(sizeof(void *) - 1);
+    if (block == NULL || block->used + size > block->size)
+    {
+        block_size = MAX(arena->block_size, size);
+        block = g_malloc0(sizeof(cpdb_arena_block_t) + block_size);
+        block->next = arena->head;
+        block->size = block_size;
+        block->used = 0;
+        arena->head = block;
+    }
+
+    mem = block->data + block->used;
+    block->used += size;
+    return mem;
+}
+
+void cpdbDeleteArena(cpdb_arena_t *arena)
+{
+    cpdb_arena_block_t *block, *next;
+
+    if (arena == NULL)
+        return;
+
+    for (block = arena->head; block != NULL; block = next)
+    {
+        next = block->next;
+        g_free(block);
+    }
+    g_free(arena);
+}
+
 void cpdbUnpackStringArray(GVariant *variant, int num_val, char ***val)
 {
     GVariantIter *iter;
@@ -238,6 +343,23 @@ char *cpdbGetUserConfDir()
     return NULL;
 }
 
+char *cpdbGetUserCacheDir()
+{
+    char *cache_dir = NULL, *env_xch, *env_home;
+
+    if ((env_xch = getenv("XDG_CACHE_HOME")) != NULL)
+        cache_dir = cpdbConcatPath(env_xch, "cpdb");
+    else if ((env_home = getenv("HOME")) != NULL)
+        cache_dir = cpdbConcatPath(env_home, ".cache/cpdb");
+
+    if (cache_dir && (access(cache_dir, R_OK) == 0 ||
+                      g_mkdir_with_parents(cache_dir, CPDB_USRCACHEDIR_PERM) == 0))
+        return cache_dir;
+
+    free(cache_dir);
+    return NULL;
+}
+
 char *cpdbGetSysConfDir()
 {
     char *config_dir = NULL, *env_xcd, *path;
@@ -274,6 +396,108 @@ char *cpdbGetSysConfDir()
     return NULL;
 }
 
+/**
+ * Options starting with the name of a common IPP option, a string literal
+ */
+#define CPDB_HAS_PREFIX(name, prefix) (strncmp(name, prefix, sizeof(prefix) - 1) == 0)
+
+const char *cpdbClassifyOption(const char *option_name)
+{
+    if (option_name == NULL)
+    {
+        cpdbDebugLog(CPDB_DEBUG_LEVEL_WARN, "Invalid params: cpdbClassifyOption()\n");
+        return NULL;
+    }
+
+    /* Only the options sharing the first letter are compared */
+    switch (option_name[0])
+    {
+        case 'b':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_BOOKLET))
+                return CPDB_GROUP_PAGE_MGMT;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_BILLING_INFO))
+                return CPDB_GROUP_JOB_MGMT;
+            break;
+        case 'c':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_COPIES))
+                return CPDB_GROUP_COPIES;
+            break;
+        case 'f':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_FINISHINGS))
+                return CPDB_GROUP_FINISHINGS;
+            break;
+        case 'i':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_FIDELITY))
+                return CPDB_GROUP_SCALING;
+            break;
+        case 'j':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_JOB_NAME) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_JOB_SHEETS) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_JOB_PRIORITY) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_JOB_HOLD_UNTIL))
+                return CPDB_GROUP_JOB_MGMT;
+            break;
+        case 'm':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_COLLATE) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_COPIES_SUPPORTED))
+                return CPDB_GROUP_COPIES;
+            /* Also covers media-type */
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_MEDIA))
+                return CPDB_GROUP_MEDIA;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_MIRROR))
+                return CPDB_GROUP_PAGE_MGMT;
+            break;
+        case 'n':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_NUMBER_UP))
+                return CPDB_GROUP_PAGE_MGMT;
+            break;
+        case 'o':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_ORIENTATION))
+                return CPDB_GROUP_PAGE_MGMT;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_OUTPUT_BIN))
+                return CPDB_GROUP_FINISHINGS;
+            break;
+        case 'p':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PAGE_SET) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PAGE_BORDER) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PAGE_RANGES))
+                return CPDB_GROUP_PAGE_MGMT;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_POSITION) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PRINT_SCALING))
+                return CPDB_GROUP_SCALING;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_COLOR_MODE))
+                return CPDB_GROUP_COLOR;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PRINT_QUALITY) ||
+                CPDB_HAS_PREFIX(option_name, CPDB_OPTION_RESOLUTION))
+                return CPDB_GROUP_QUALITY;
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_PAGE_DELIVERY))
+                return CPDB_GROUP_FINISHINGS;
+            break;
+        case 's':
+            if (CPDB_HAS_PREFIX(option_name, CPDB_OPTION_SIDES))
+                return CPDB_GROUP_PAGE_MGMT;
+            break;
+    }
+
+    return CPDB_GROUP_ADVANCED;
+}
+
+void cpdbClassifyOptions(const char *const *option_names,
+                         int num_options,
+                         const char **groups)
+{
+    int i;
+
+    if (option_names == NULL || groups == NULL)
+    {
+        cpdbDebugLog(CPDB_DEBUG_LEVEL_WARN, "Invalid params: cpdbClassifyOptions()\n");
+        return;
+    }
+
+    for (i = 0; i < num_options; i++)
+        groups[i] = option_names[i] ? cpdbClassifyOption(option_names[i]) : NULL;
+}
+
 char *cpdbGetGroup(const char *option_name)
 {
     if (option_name == NULL)
@@ -282,39 +506,155 @@ char *cpdbGetGroup(const char *option_name)
         return NULL;
     }
 
-    int num_group = sizeof(cpdbGroupTable) / sizeof(cpdbGroupTable[0]);
-    for (int i = 0; i < num_group; i++)
+    return cpdbGetStringCopy(cpdbClassifyOption(option_name));
+}
+
+#define CPDB_MO_MAGIC           0x950412de
+#define CPDB_MO_MAGIC_SWAPPED   0xde120495
+
+static guint32 cpdbReadMoWord(const char *data,
+                              gsize offset,
+                              gboolean swapped)
+{
+    guint32 word;
+
+    memcpy(&word, data + offset, sizeof(word));
+    if (swapped)
+        word = ((word & 0xff) << 24) | ((word & 0xff00) << 8) |
+               ((word >> 8) & 0xff00) | (word >> 24);
+    return word;
+}
+
+/**
+ * Get a NUL-terminated string of a .mo file, NULL if out of bounds.
+ */
+static const char *cpdbGetMoString(const char *data,
+                                   gsize size,
+                                   gsize table,
+                                   guint32 index,
+                                   gboolean swapped)
+{
+    guint32 length, offset;
+
+    if (table + 8 * (gsize) index + 8 > size)
+        return NULL;
+    length = cpdbReadMoWord(data, table + 8 * index, swapped);
+    offset = cpdbReadMoWord(data, table + 8 * index + 4, swapped);
+    if ((gsize) offset + length >= size || data[offset + length] != '\0')
+        return NULL;
+    return data + offset;
+}
+
+static cpdb_catalog_t *cpdbLoadCatalog(const char *locale)
+{
+    char *path;
+    const char *data, *msgid, *msgstr;
+    gsize size;
+    guint32 magic, num_strings, orig_table, trans_table, i;
+    gboolean swapped;
+    GMappedFile *file;
+    cpdb_catalog_t *catalog;
+
+    path = g_strdup_printf("%s/%s/LC_MESSAGES/%s.mo",
+                           CPDB_LOCALEDIR, locale, CPDB_GETTEXT_PACKAGE);
+    file = g_mapped_file_new(path, FALSE, NULL);
+    g_free(path);
+    if (file == NULL)
+        return NULL;
+
+    data = g_mapped_file_get_contents(file);
+    size = g_mapped_file_get_length(file);
+    magic = size >= 20 ? cpdbReadMoWord(data, 0, FALSE) : 0;
+    if (magic != CPDB_MO_MAGIC && magic != CPDB_MO_MAGIC_SWAPPED)
+    {
+        cpdbDebugLog(CPDB_DEBUG_LEVEL_WARN, "Invalid message catalog\n");
+        g_mapped_file_unref(file);
+        return NULL;
+    }
+    swapped = magic == CPDB_MO_MAGIC_SWAPPED;
+    num_strings = cpdbReadMoWord(data, 8, swapped);
+    orig_table = cpdbReadMoWord(data, 12, swapped);
+    trans_table = cpdbReadMoWord(data, 16, swapped);
+
+    catalog = g_new0(cpdb_catalog_t, 1);
+    catalog->file = file;
+    catalog->messages = g_hash_table_new(g_str_hash, g_str_equal);
+
+    /* Plural forms follow the NUL of the singular ones, and are ignored */
+    for (i = 0; i < num_strings; i++)
+    {
+        msgid = cpdbGetMoString(data, size, orig_table, i, swapped);
+        msgstr = cpdbGetMoString(data, size, trans_table, i, swapped);
+        if (msgid == NULL || msgstr == NULL)
+            break;
+        if (msgid[0] != '\0' && msgstr[0] != '\0')
+            g_hash_table_insert(catalog->messages, (gpointer) msgid, (gpointer) msgstr);
+    }
+
+    return catalog;
+}
+
+/**
+ * Get the message catalog of a locale, loading it the first time.
+ */
+static cpdb_catalog_t *cpdbGetCatalog(const char *locale)
+{
+    cpdb_catalog_t *catalog;
+
+    g_mutex_lock(&catalog_mutex);
+    if (catalogs == NULL)
+        catalogs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+
+    if (!g_hash_table_lookup_extended(catalogs, locale, NULL, (gpointer *) &catalog))
     {
-        if (strncmp(option_name, cpdbGroupTable[i][0], strlen(cpdbGroupTable[i][0])) == 0)
-            return cpdbGetStringCopy(cpdbGroupTable[i][1]);
+        catalog = cpdbLoadCatalog(locale);
+        g_hash_table_insert(catalogs, g_strdup(locale), catalog);
     }
+    g_mutex_unlock(&catalog_mutex);
 
-    return cpdbGetStringCopy(CPDB_GROUP_ADVANCED);
+    return catalog;
 }
 
 char *cpdbGetGroupTranslation2(const char *group_name, const char *lang)
 {
-    setenv("LANGUAGE", lang, 1);
+    int i, j;
+    char **langs, **variants;
+    const char *translation = NULL;
+    cpdb_catalog_t *catalog;
+
+    if (group_name == NULL || lang == NULL)
+    {
+        cpdbDebugLog(CPDB_DEBUG_LEVEL_WARN, "Invalid params: cpdbGetGroupTranslation2()\n");
+        return NULL;
+    }
 
+    /* Catalogs are immutable once loaded, so looked up without the lock */
+    langs = g_strsplit(lang, ":", -1);
+    for (i = 0; langs[i] != NULL && translation == NULL; i++)
     {
-        extern int  _nl_msg_cat_cntr;
-        ++_nl_msg_cat_cntr;
+        if (langs[i][0] == '\0' || strcmp(langs[i], "C") == 0 || strcmp(langs[i], "POSIX") == 0)
+            continue;
+
+        variants = g_get_locale_variants(langs[i]);
+        for (j = 0; variants[j] != NULL && translation == NULL; j++)
+        {
+            if ((catalog = cpdbGetCatalog(variants[j])) != NULL)
+                translation = g_hash_table_lookup(catalog->messages, group_name);
+        }
+        g_strfreev(variants);
     }
+    g_strfreev(langs);
 
-    return cpdbGetStringCopy(_(group_name));
+    return cpdbGetStringCopy(translation ? translation : group_name);
 }
 
-static void cpdbDebugLog(CpdbDebugLevel msg_lvl, const char *msg)
+int cpdbResolveDebugLevel()
 {
-    FILE *log_file = NULL, *out;
-    char *env_cdl, *env_cdlf;
+    char *env_cdl;
     CpdbDebugLevel dbg_lvl;
 
-    if (msg == NULL)
-        return;
-
     dbg_lvl = CPDB_DEBUG_LEVEL_ERROR;
-    if (env_cdl = getenv(CPDB_DEBUG_LEVEL))
+    if ((env_cdl = getenv(CPDB_DEBUG_LEVEL)) != NULL)
     {
 		if (strncasecmp(env_cdl, "debug", 5) == 0)
 			dbg_lvl = CPDB_DEBUG_LEVEL_DEBUG;
@@ -323,15 +663,203 @@ static void cpdbDebugLog(CpdbDebugLevel msg_lvl, const char *msg)
         else if (strncasecmp(env_cdl, "warn", 4) == 0)
             dbg_lvl = CPDB_DEBUG_LEVEL_WARN;
     }
-    if (msg_lvl < dbg_lvl)
-		return;
-    
-    out = stderr;
-    if (env_cdlf = getenv(CPDB_DEBUG_LOGFILE))
+
+    /* Racing threads resolve the same value */
+    g_atomic_int_set(&cpdbDebugThreshold, dbg_lvl);
+    return dbg_lvl;
+}
+
+void cpdbSetDebugLevel(CpdbDebugLevel msg_lvl)
+{
+    g_atomic_int_set(&cpdbDebugThreshold, msg_lvl);
+}
+
+/* Must be called with log_mutex held */
+static void cpdbConfigureLogging()
+{
+    char *env_cdlf;
+
+    if (log_configured)
+        return;
+    log_configured = TRUE;
+
+    if ((env_cdlf = getenv(CPDB_DEBUG_LOGFILE)) == NULL)
+        return;
+    if ((log_file = fopen(env_cdlf, "a")) == NULL)
     {
-        if ((log_file = fopen(env_cdlf, "a")) != NULL)
-			out = log_file;
-	}
+        fprintf(stderr, "[Warn] Couldn't open log file %s, logging to stderr\n", env_cdlf);
+        return;
+    }
+
+    /* Buffered, but without losing whole lines on a crash */
+    setvbuf(log_file, NULL, _IOLBF, BUFSIZ);
+}
+
+static gboolean cpdbEnqueueLog(CpdbDebugLevel msg_lvl, const char *msg)
+{
+    guint pos;
+    gint diff;
+    cpdb_log_record_t *rec;
+
+    pos = g_atomic_int_get(&log_enqueue_pos);
+    for (;;)
+    {
+        rec = &log_queue[pos % CPDB_LOG_QUEUE_SIZE];
+        diff = (gint) ((guint) g_atomic_int_get(&rec->sequence) - pos);
+        if (diff == 0)
+        {
+            if (g_atomic_int_compare_and_exchange(&log_enqueue_pos, pos, pos + 1))
+                break;
+            pos = g_atomic_int_get(&log_enqueue_pos);
+        }
+        else if (diff < 0)
+        {
+            /* The writer hasn't freed this slot yet, the queue is full */
+            return FALSE;
+        }
+        else
+        {
+            pos = g_atomic_int_get(&log_enqueue_pos);
+        }
+    }
+
+    rec->msg_lvl = msg_lvl;
+    g_strlcpy(rec->msg, msg, sizeof(rec->msg));
+    g_atomic_int_set(&rec->sequence, pos + 1);
+    return TRUE;
+}
+
+static gboolean cpdbDequeueLog()
+{
+    guint pos = log_dequeue_pos;
+    cpdb_log_record_t *rec = &log_queue[pos % CPDB_LOG_QUEUE_SIZE];
+
+    if ((guint) g_atomic_int_get(&rec->sequence) != pos + 1)
+        return FALSE;
+
+    cpdbWriteLog(rec->msg_lvl, rec->msg);
+    g_atomic_int_set(&rec->sequence, pos + CPDB_LOG_QUEUE_SIZE);
+    log_dequeue_pos = pos + 1;
+    return TRUE;
+}
+
+static gpointer log_writer_thread(gpointer data)
+{
+    guint dropped, reported = 0;
+    char msg[CPDB_BSIZE];
+
+    for (;;)
+    {
+        while (cpdbDequeueLog())
+            ;
+
+        dropped = g_atomic_int_get(&log_dropped);
+        if (dropped != reported)
+        {
+            snprintf(msg, sizeof(msg), "Dropped %u log messages\n", dropped - reported);
+            cpdbWriteLog(CPDB_DEBUG_LEVEL_WARN, msg);
+            reported = dropped;
+        }
+        if (!g_atomic_int_get(&log_async))
+            break;
+
+        /* Loggers only take the mutex to wake the writer up,
+         * the timeout covers a wakeup racing with going to sleep */
+        g_mutex_lock(&log_writer_mutex);
+        g_atomic_int_set(&log_writer_waiting, TRUE);
+        g_cond_wait_until(&log_writer_cond, &log_writer_mutex,
+                          g_get_monotonic_time() + 100 * G_TIME_SPAN_MILLISECOND);
+        g_atomic_int_set(&log_writer_waiting, FALSE);
+        g_mutex_unlock(&log_writer_mutex);
+    }
+
+    return NULL;
+}
+
+static void cpdbStopAsyncLogging()
+{
+    cpdbSetAsyncLogging(FALSE);
+}
+
+void cpdbSetAsyncLogging(gboolean async)
+{
+    int i;
+    static gboolean initialized_queue = FALSE;
+
+    g_mutex_lock(&log_writer_mutex);
+    if (async && log_writer == NULL)
+    {
+        if (!initialized_queue)
+        {
+            for (i = 0; i < CPDB_LOG_QUEUE_SIZE; i++)
+                log_queue[i].sequence = i;
+            atexit(cpdbStopAsyncLogging);
+            initialized_queue = TRUE;
+        }
+        g_atomic_int_set(&log_async, TRUE);
+        log_writer = g_thread_new("cpdb-log", log_writer_thread, NULL);
+    }
+    else if (!async && log_writer != NULL)
+    {
+        g_atomic_int_set(&log_async, FALSE);
+        g_cond_signal(&log_writer_cond);
+        g_mutex_unlock(&log_writer_mutex);
+        g_thread_join(log_writer);
+
+        /* Loggers which still saw log_async set finish queueing first.
+         * They might need the mutex to wake up the writer. */
+        while (g_atomic_int_get(&log_producers) > 0)
+            g_thread_yield();
+        g_mutex_lock(&log_writer_mutex);
+        log_writer = NULL;
+
+        /* Messages queued while the writer was exiting */
+        while (cpdbDequeueLog())
+            ;
+    }
+    g_mutex_unlock(&log_writer_mutex);
+}
+
+guint cpdbGetDroppedLogCount()
+{
+    return g_atomic_int_get(&log_dropped);
+}
+
+static void cpdbDebugLog(CpdbDebugLevel msg_lvl, const char *msg)
+{
+    if (msg == NULL)
+        return;
+
+    /* Counted before checking the flag, so that a logger which
+     * still sees it set is waited for when disabling */
+    g_atomic_int_inc(&log_producers);
+    if (g_atomic_int_get(&log_async))
+    {
+        if (!cpdbEnqueueLog(msg_lvl, msg))
+        {
+            g_atomic_int_inc(&log_dropped);
+        }
+        else if (g_atomic_int_get(&log_writer_waiting))
+        {
+            g_mutex_lock(&log_writer_mutex);
+            g_cond_signal(&log_writer_cond);
+            g_mutex_unlock(&log_writer_mutex);
+        }
+        g_atomic_int_dec_and_test(&log_producers);
+        return;
+    }
+    g_atomic_int_dec_and_test(&log_producers);
+
+    cpdbWriteLog(msg_lvl, msg);
+}
+
+static void cpdbWriteLog(CpdbDebugLevel msg_lvl, const char *msg)
+{
+    FILE *out;
+
+    g_mutex_lock(&log_mutex);
+    cpdbConfigureLogging();
+    out = log_file ? log_file : stderr;
 
 	switch(msg_lvl)
 	{
@@ -348,13 +876,139 @@ static void cpdbDebugLog(CpdbDebugLevel msg_lvl, const char *msg)
 			fprintf(out, "[Error] %s", msg);
 			break;
 	}
+    g_mutex_unlock(&log_mutex);
+}
+
+void cpdbSetTracing(gboolean enable)
+{
+    g_mutex_lock(&trace_mutex);
+    if (enable && trace_ring == NULL)
+        trace_ring = g_new0(cpdb_trace_event_t, CPDB_TRACE_RING_SIZE);
+    g_atomic_int_set(&cpdbTraceActive, enable);
+    g_mutex_unlock(&trace_mutex);
+}
+
+static guint32 cpdbTraceThread()
+{
+    gpointer thread = g_private_get(&trace_thread);
+
+    if (thread == NULL)
+    {
+        thread = GINT_TO_POINTER(g_atomic_int_add(&trace_num_threads, 1) + 1);
+        g_private_set(&trace_thread, thread);
+    }
+    return GPOINTER_TO_UINT(thread);
+}
+
+static void cpdbTraceRecord(CpdbTraceEventType type,
+                            const char *name,
+                            const char *arg,
+                            gint64 timestamp,
+                            gint64 duration,
+                            gint64 value,
+                            gint64 size)
+{
+    cpdb_trace_event_t *ev;
+    guint32 thread = cpdbTraceThread();
+
+    g_mutex_lock(&trace_mutex);
+    if (!g_atomic_int_get(&cpdbTraceActive) || trace_ring == NULL)
+    {
+        g_mutex_unlock(&trace_mutex);
+        return;
+    }
+
+    ev = &trace_ring[trace_count++ % CPDB_TRACE_RING_SIZE];
+    ev->timestamp = timestamp;
+    ev->duration = duration;
+    ev->value = value;
+    ev->size = size;
+    ev->thread = thread;
+    ev->type = type;
+    g_strlcpy(ev->name, name ? name : "", sizeof(ev->name));
+    g_strlcpy(ev->arg, arg ? arg : "", sizeof(ev->arg));
+    g_mutex_unlock(&trace_mutex);
+}
+
+void cpdbTraceComplete(CpdbTraceEventType type,
+                       const char *name,
+                       const char *arg,
+                       gint64 start,
+                       gint64 value,
+                       gint64 size)
+{
+    /* Tracing was off when the operation started */
+    if (start == 0 || !g_atomic_int_get(&cpdbTraceActive))
+        return;
+
+    cpdbTraceRecord(type, name, arg, start,
+                    g_get_monotonic_time() - start, value, size);
+}
+
+void cpdbTraceInstant(CpdbTraceEventType type,
+                      const char *name,
+                      const char *arg,
+                      gint64 value)
+{
+    if (!g_atomic_int_get(&cpdbTraceActive))
+        return;
+
+    cpdbTraceRecord(type, name, arg, g_get_monotonic_time(), -1, value, 0);
+}
+
+gboolean cpdbDumpTrace(const char *path)
+{
+    FILE *fp;
+    guint64 first, i;
+    gboolean ok;
+    cpdb_trace_header_t header;
+
+    if (path == NULL)
+        return FALSE;
+
+    if ((fp = fopen(path, "wb")) == NULL)
+    {
+        cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_ERROR,
+                         "Couldn't open %s for writing the trace\n", path);
+        return FALSE;
+    }
+
+    g_mutex_lock(&trace_mutex);
+    first = trace_count > CPDB_TRACE_RING_SIZE ? trace_count - CPDB_TRACE_RING_SIZE : 0;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, CPDB_TRACE_MAGIC, sizeof(header.magic));
+    header.version = CPDB_TRACE_VERSION;
+    header.event_size = sizeof(cpdb_trace_event_t);
+    header.num_events = trace_count - first;
+    header.num_lost = first;
+
+    ok = fwrite(&header, sizeof(header), 1, fp) == 1;
+    for (i = first; ok && i < trace_count; i++)
+        ok = fwrite(&trace_ring[i % CPDB_TRACE_RING_SIZE],
+                    sizeof(cpdb_trace_event_t), 1, fp) == 1;
+    g_mutex_unlock(&trace_mutex);
+
+    if (fclose(fp) != 0)
+        ok = FALSE;
+    if (!ok)
+        cpdbFDebugPrintf(CPDB_DEBUG_LEVEL_ERROR,
+                         "Couldn't write the trace to %s\n", path);
+    return ok;
+}
+
+static void cpdbDumpTraceAtExit()
+{
+    cpdbDumpTrace(getenv(CPDB_TRACE_FILE));
 }
 
 void cpdbFDebugPrintf(CpdbDebugLevel msg_lvl, const char *fmt, ...)
 {
     va_list argptr;
 	char buf[CPDB_BSIZE], msg[CPDB_BSIZE + 12];
-	
+
+	if (!cpdbDebugEnabled(msg_lvl))
+		return;
+
 	va_start(argptr, fmt);
 	vsnprintf(buf, sizeof(buf), fmt, argptr);
     snprintf(msg, sizeof(msg), "[Frontend] %s", buf);
@@ -368,7 +1022,10 @@ void cpdbBDebugPrintf(CpdbDebugLevel msg_lvl, const char *backend_name,
 {
     va_list argptr;
 	char buf[CPDB_BSIZE], msg[CPDB_BSIZE + 12];
-	
+
+	if (!cpdbDebugEnabled(msg_lvl))
+		return;
+
 	va_start(argptr, fmt);
 	vsnprintf(buf, sizeof(buf), fmt, argptr);
     snprintf(msg, sizeof(msg), "[Backend %s] %s", backend_name, buf);
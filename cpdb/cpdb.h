@@ -26,10 +26,25 @@ extern "C" {
  * if needed to be created */
 #define CPDB_USRCONFDIR_PERM 0755
 #define CPDB_SYSCONFDIR_PERM 0755
+#define CPDB_USRCACHEDIR_PERM 0700
 
 /* Environment variables for printing debug info */
 #define CPDB_DEBUG_LEVEL   "CPDB_DEBUG_LEVEL"
 #define CPDB_DEBUG_LOGFILE "CPDB_DEBUG_LOGFILE"
+#define CPDB_DEBUG_ASYNC   "CPDB_DEBUG_ASYNC"
+
+/* Number of messages queued for the log writer thread */
+#define CPDB_LOG_QUEUE_SIZE 512
+
+/* Environment variable enabling tracing, the trace is written there at exit */
+#define CPDB_TRACE_FILE "CPDB_TRACE_FILE"
+
+/* Number of events kept by the trace ring buffer */
+#define CPDB_TRACE_RING_SIZE 16384
+
+/* Trace files start with a cpdb_trace_header_t */
+#define CPDB_TRACE_MAGIC "CPDBTRCE"
+#define CPDB_TRACE_VERSION 2
 
 #define CPDB_BACKEND_OBJ_PATH "/"
 
@@ -46,6 +61,11 @@ extern "C" {
 #define CPDB_JOB_ARGS "(ssssssi)"
 #define CPDB_JOB_ARRAY_ARGS "a(ssssssi)"
 
+/* Default size of the blocks of a cpdb_arena_t */
+#define CPDB_ARENA_BLOCK_SIZE 16384
+
+typedef struct cpdb_arena_s cpdb_arena_t;
+
 typedef enum {
     CPDB_DEBUG_LEVEL_DEBUG,
     CPDB_DEBUG_LEVEL_INFO,
@@ -53,8 +73,133 @@ typedef enum {
     CPDB_DEBUG_LEVEL_ERROR,
 } CpdbDebugLevel;
 
+/* Lowest level of the messages logged, -1 until resolved from CPDB_DEBUG_LEVEL */
+extern volatile gint cpdbDebugThreshold;
+
+/**
+ * Resolve the debug level from the environment, done once.
+ */
+int cpdbResolveDebugLevel();
+
 /**
- * Initializes CPDB.
+ * Set the lowest level of the messages logged,
+ * overriding CPDB_DEBUG_LEVEL.
+ */
+void cpdbSetDebugLevel(CpdbDebugLevel msg_lvl);
+
+/**
+ * Write the log messages from a background thread instead of the
+ * calling one. Also enabled by setting CPDB_DEBUG_ASYNC before cpdbInit().
+ *
+ * Messages are queued, up to CPDB_LOG_QUEUE_SIZE, and dropped when
+ * the queue is full. Disabling writes out the queued messages.
+ */
+void cpdbSetAsyncLogging(gboolean async);
+
+/**
+ * Get the number of log messages dropped because the queue was full.
+ */
+guint cpdbGetDroppedLogCount();
+
+typedef enum {
+    CPDB_TRACE_ACTIVATION,      /** Backend activation, arg is the backend **/
+    CPDB_TRACE_BACKEND_CALL,    /** Backend method call, arg is the backend, value the error code **/
+    CPDB_TRACE_SIGNAL,          /** Backend signal, arg is the backend **/
+    CPDB_TRACE_UNPACK,          /** Options unpacked, value is their number, size the message size **/
+} CpdbTraceEventType;
+
+/**
+ * Header of a trace file, followed by num_events cpdb_trace_event_t
+ * records in the order they completed. Their timestamps are start times,
+ * so they aren't sorted. All in host byte order.
+ */
+typedef struct cpdb_trace_header_s
+{
+    char magic[8];
+    guint32 version;
+    guint32 event_size;     /** sizeof(cpdb_trace_event_t) **/
+    guint32 num_events;
+    guint32 reserved;
+    guint64 num_lost;       /** Events overwritten in the ring **/
+} cpdb_trace_header_t;
+
+typedef struct cpdb_trace_event_s
+{
+    gint64 timestamp;       /** Monotonic time in microseconds **/
+    gint64 duration;        /** In microseconds, -1 for instant events **/
+    gint64 value;
+    gint64 size;
+    guint32 thread;         /** Small number identifying the thread **/
+    guint32 type;           /** CpdbTraceEventType **/
+    char name[40];
+    char arg[48];
+} cpdb_trace_event_t;
+
+/* Whether trace events are recorded */
+extern volatile gint cpdbTraceActive;
+
+/**
+ * Start or stop recording trace events into the ring buffer.
+ * Also enabled by setting CPDB_TRACE_FILE before cpdbInit().
+ *
+ * Only the last CPDB_TRACE_RING_SIZE events are kept,
+ * stopping keeps them around for cpdbDumpTrace().
+ */
+void cpdbSetTracing(gboolean enable);
+
+/**
+ * Get the start time of a traced operation, 0 when not tracing.
+ */
+static inline gint64 cpdbTraceStart()
+{
+    return g_atomic_int_get(&cpdbTraceActive) ? g_get_monotonic_time() : 0;
+}
+
+/**
+ * Record an operation which started at a time got from cpdbTraceStart().
+ *
+ * @param type      Event type
+ * @param name      Operation name
+ * @param arg       Backend name or other argument, may be NULL
+ * @param start     Start time
+ * @param value     Event specific value
+ * @param size      Event specific size
+ */
+void cpdbTraceComplete(CpdbTraceEventType type, const char *name,
+                       const char *arg, gint64 start,
+                       gint64 value, gint64 size);
+
+/**
+ * Record an event without duration.
+ */
+void cpdbTraceInstant(CpdbTraceEventType type, const char *name,
+                      const char *arg, gint64 value);
+
+/**
+ * Write the recorded trace events to a file,
+ * which tools/cpdb-trace-convert turns into Chrome trace JSON.
+ *
+ * @returns TRUE on success
+ */
+gboolean cpdbDumpTrace(const char *path);
+
+/**
+ * Check whether messages of a debug level are logged at all,
+ * to skip formatting them otherwise.
+ */
+static inline gboolean cpdbDebugEnabled(CpdbDebugLevel msg_lvl)
+{
+    int threshold = g_atomic_int_get(&cpdbDebugThreshold);
+
+    if (G_UNLIKELY(threshold < 0))
+        threshold = cpdbResolveDebugLevel();
+    return (int) msg_lvl >= threshold;
+}
+
+/**
+ * Initializes CPDB, including the logging configuration
+ * from CPDB_DEBUG_LEVEL, CPDB_DEBUG_LOGFILE and CPDB_DEBUG_ASYNC,
+ * and tracing from CPDB_TRACE_FILE.
  * It’s the responsibility of the main program to set the locale.
  */
 void cpdbInit();
@@ -89,11 +234,47 @@ char *cpdbConcatPath(const char *s1, const char *s2);
  */
 char *cpdbGetStringCopy(const char *s);
 
+/**
+ * Get a shared copy of a string.
+ *
+ * Equal strings share a single reference counted copy, so interned
+ * strings can be compared by pointer. Release with cpdbReleaseString(),
+ * never with free().
+ */
+char *cpdbInternString(const char *s);
+
+/**
+ * Release a string obtained from cpdbInternString().
+ */
+void cpdbReleaseString(char *s);
+
+/**
+ * Get a new arena, allocating memory in blocks of block_size bytes,
+ * or CPDB_ARENA_BLOCK_SIZE if 0.
+ */
+cpdb_arena_t *cpdbNewArena(size_t block_size);
+
+/**
+ * Get zeroed memory from an arena.
+ * It is only freed along with the arena.
+ */
+void *cpdbArenaAlloc(cpdb_arena_t *arena, size_t size);
+
+/**
+ * Free up an arena and all the memory allocated from it.
+ */
+void cpdbDeleteArena(cpdb_arena_t *arena);
+
 /**
  * Get directory for user configuration files.
  */
 char *cpdbGetUserConfDir();
 
+/**
+ * Get directory for user cache files.
+ */
+char *cpdbGetUserCacheDir();
+
 /**
  * Get directory for system wide configuration files.
  */
@@ -114,8 +295,37 @@ char *cpdbExtractFileName(const char* file_path);
  */
 char *cpdbGetGroup(const char *option_name);
 
+/**
+ * Get the group of an option without copying it.
+ *
+ * @param option_name       Option name
+ *
+ * @return                  One of the CPDB_GROUP_* constants, CPDB_GROUP_ADVANCED
+ *                          for options of no common group
+ */
+const char *cpdbClassifyOption(const char *option_name);
+
+/**
+ * Get the groups of several options at once, see cpdbClassifyOption().
+ *
+ * @param option_names      Option names
+ * @param num_options       Number of options
+ * @param groups            Array of num_options, filled with the groups
+ */
+void cpdbClassifyOptions(const char *const *option_names, int num_options, const char **groups);
+
 /**
  * Get translation for given group name.
+ *
+ * The message catalog of each locale is read from CPDB_LOCALEDIR once and
+ * kept for the life of the process, trying the less specific variants of
+ * the locale as gettext does. Neither the environment nor the gettext
+ * state of the process are touched, so it is safe to call from any thread.
+ *
+ * @param group_name        Group name
+ * @param locale            Locale, or a colon-separated list of locales by preference
+ *
+ * @return                  Translated group name, or a copy of group_name if none
  */
 char *cpdbGetGroupTranslation2(const char *group_name, const char *locale);
 
@@ -5,7 +5,7 @@ AC_PROG_CC
 
 PKG_CHECK_MODULES([GIO],[gio-2.0]) 
 PKG_CHECK_MODULES([GIOUNIX],[gio-unix-2.0]) 
-PKG_CHECK_MODULES([GLIB],[glib-2.0]) 
+PKG_CHECK_MODULES([GLIB],[glib-2.0 >= 2.58]) 
 
 # Checks for header files. 
 AC_CHECK_HEADERS([stdlib.h string.h unistd.h sys/stat.h]) 
@@ -61,22 +61,16 @@ static void printOption(const cpdb_option_t *opt)
     printf(" --> DEFAULT: %s\n\n", opt->default_value);
 }
 
-static void printTranslations(cpdb_printer_obj_t *p)
+static void printTranslation(const char *key, const char *translation, void *user_data)
 {
-    GHashTableIter iter;
-    gpointer key, value;
+    printf("'%s' : '%s'\n", key, translation);
+}
 
-    if (p->locale == NULL || p->translations == NULL)
-    {
+static void printTranslations(cpdb_printer_obj_t *p)
+{
+    /* Also called from the command thread, while the main loop runs */
+    if (!cpdbForEachTranslation(p, locale, printTranslation, NULL))
         printf("No translations found\n");
-        return;
-    }
-
-    g_hash_table_iter_init(&iter, p->translations);
-    while (g_hash_table_iter_next(&iter, &key, &value))
-    {
-        printf("'%s' : '%s'\n", (char *)key, (char *)value);
-    }
 }
 
 static void displayAllPrinters(cpdb_frontend_obj_t *f)
@@ -219,6 +213,59 @@ gpointer control_thread(gpointer user_data)
                 printOption(value);
             }
         }
+        else if (strcmp(buf, "get-options-view") == 0)
+        {
+            char printer_id[BUFSIZE];
+            char backend_name[BUFSIZE];
+            scanf("%1023s%1023s", printer_id, backend_name);
+            cpdb_printer_obj_t *p = cpdbFindPrinterObj(f, printer_id, backend_name);
+
+            if(p == NULL)
+              continue;
+
+            cpdb_options_view_t *view = cpdbGetOptionsView(p);
+            if (view == NULL)
+                continue;
+
+            printf("Retrieved %d options.\n", cpdbGetOptionsViewCount(view));
+            for (int i = 0; i < cpdbGetOptionsViewCount(view); i++)
+            {
+                const cpdb_option_view_t *opt = cpdbGetOptionViewAt(view, i);
+                printf("[+] %s\n", opt->option_name);
+                printf(" --> GROUP: %s\n", opt->group_name);
+                for (int j = 0; j < opt->num_supported; j++)
+                    printf("   * %s\n", opt->supported_values[j]);
+                printf(" --> DEFAULT: %s\n\n", opt->default_value);
+            }
+            cpdbDeleteOptionsView(view);
+        }
+        else if (strcmp(buf, "validate-settings") == 0)
+        {
+            char printer_id[BUFSIZE];
+            char backend_name[BUFSIZE];
+            scanf("%1023s%1023s", printer_id, backend_name);
+            cpdb_printer_obj_t *p = cpdbFindPrinterObj(f, printer_id, backend_name);
+
+            if(p == NULL)
+              continue;
+
+            static const char *violation_types[] = {
+                "unknown option",
+                "unsupported value",
+                "unknown media",
+                "unsupported margins",
+            };
+            cpdb_violation_t *violations;
+            int num_violations = cpdbValidateSettings(p, NULL, &violations);
+            if (num_violations < 0)
+                continue;
+
+            printf("Found %d invalid settings.\n", num_violations);
+            for (int i = 0; i < num_violations; i++)
+                printf("%s : %s = %s\n", violation_types[violations[i].type],
+                       violations[i].option_name, violations[i].value);
+            cpdbDeleteViolations(violations, num_violations);
+        }
         else if (strcmp(buf, "get-all-media") == 0)
         {
             char printer_id[BUFSIZE];
@@ -310,6 +357,27 @@ gpointer control_thread(gpointer user_data)
         {
             display_help();
         }
+        else if (strcmp(buf, "call-stats") == 0)
+        {
+            cpdbPrintCallStats(f, stdout);
+        }
+        else if (strcmp(buf, "reset-call-stats") == 0)
+        {
+            cpdbResetCallStats(f);
+        }
+        else if (strcmp(buf, "trace") == 0)
+        {
+            char state[BUFSIZE];
+            scanf("%1023s", state);
+            cpdbSetTracing(strcmp(state, "on") == 0);
+        }
+        else if (strcmp(buf, "dump-trace") == 0)
+        {
+            char file_path[BUFSIZE];
+            scanf("%1023s", file_path);
+            if (cpdbDumpTrace(file_path))
+                printf("Trace written to %s\n", file_path);
+        }
         else if (strcmp(buf, "ping") == 0)
         {
             char printer_id[BUFSIZE], backend_name[BUFSIZE];
@@ -405,6 +473,7 @@ gpointer control_thread(gpointer user_data)
             {
                 printf("%s .. %s  .. %s  .. %s  .. %s\n", j[i].job_id, j[i].title, j[i].printer_id, j[i].state, j[i].submitted_at);
             }
+            cpdbDeleteJobs(j, x);
         }
         else if (strcmp(buf, "cancel-job") == 0)
         {
@@ -476,6 +545,17 @@ gpointer control_thread(gpointer user_data)
             if (ok)
                 printf("%dx%d\n", width, length);
         }
+        else if (strcmp(buf, "get-media-for-size") == 0)
+        {
+            char printer_id[BUFSIZE];
+            char backend_name[BUFSIZE];
+            int width, length;
+            scanf("%d%d%1023s%1023s", &width, &length, printer_id, backend_name);
+            cpdb_printer_obj_t *p = cpdbFindPrinterObj(f, printer_id, backend_name);
+            cpdb_media_t *m = cpdbGetMediaForSize(p, width, length, -1);
+            if (m)
+                printf("%s (%dx%d)\n", m->name, m->width, m->length);
+        }
         else if (strcmp(buf, "get-media-margins") == 0)
         {
             char printer_id[BUFSIZE];
@@ -502,6 +582,22 @@ gpointer control_thread(gpointer user_data)
             g_message("Acquiring printer details asynchronously...\n");
             cpdbAcquireDetails(p, acquire_details_callback, NULL);
 	}
+        else if (strcmp(buf, "acquire-all-details") == 0)
+        {
+            int num_printers = 0;
+            gpointer value;
+            GHashTableIter iter;
+            cpdb_printer_obj_t **printers = g_new(cpdb_printer_obj_t *,
+                                                  g_hash_table_size(f->printer));
+
+            g_hash_table_iter_init(&iter, f->printer);
+            while (g_hash_table_iter_next(&iter, NULL, &value))
+                printers[num_printers++] = value;
+
+            g_message("Acquiring details of %d printers asynchronously...\n", num_printers);
+            cpdbAcquireDetailsBatch(printers, num_printers, acquire_details_callback, NULL);
+            g_free(printers);
+        }
         else if (strcmp(buf, "acquire-translations") == 0)
         {
             char printer_id[BUFSIZE];
@@ -538,18 +634,26 @@ void display_help()
     printf("%s\n", "is-accepting-jobs <printer id> <backend name(like \"CUPS\")>");
     printf("%s\n", "cancel-job <job-id> <printer id> <backend name>");
     printf("%s\n", "acquire-details <printer id> <backend name>");
+    printf("%s\n", "acquire-all-details");
     printf("%s\n", "acquire-translations <printer id> <backend name>");
     printf("%s\n", "get-all-options <printer-name> <backend-name>");
+    printf("%s\n", "get-options-view <printer-name> <backend-name>");
     printf("%s\n", "get-default <option name> <printer id> <backend name>");
     printf("%s\n", "get-setting <option name> <printer id> <backend name>");
     printf("%s\n", "get-current <option name> <printer id> <backend name>");
     printf("%s\n", "add-setting <option name> <option value> <printer id> <backend name>");
     printf("%s\n", "clear-setting <option name> <printer id> <backend name>");
+    printf("%s\n", "validate-settings <printer id> <backend name>");
     printf("%s\n", "get-media-size <media> <printer id> <backend name>");
     printf("%s\n", "get-media-margins <media> <printer id> <backend name>");
+    printf("%s\n", "get-media-for-size <width> <length> <printer id> <backend name>");
     printf("%s\n", "get-option-translation <option> <printer id> <backend name>");
     printf("%s\n", "get-choice-translation <option> <choice> <printer id> <backend name>");
     printf("%s\n", "get-group-translation <group> <printer id> <backend name>");
     printf("%s\n", "get-all-translations <printer id> <backend name>");
+    printf("%s\n", "call-stats");
+    printf("%s\n", "reset-call-stats");
+    printf("%s\n", "trace <on|off>");
+    printf("%s\n", "dump-trace <file path> (events recorded while tracing, also enabled by CPDB_TRACE_FILE)");
     printf("%s\n", "pickle-printer <printer id> <backend name>\n");
 }
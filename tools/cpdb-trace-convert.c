@@ -0,0 +1,128 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <cpdb/cpdb.h>
+
+static const char *event_categories[] = {
+    "activation",
+    "call",
+    "signal",
+    "unpack",
+};
+
+static void printJsonString(FILE *out, const char *str, size_t max)
+{
+    size_t i;
+
+    fputc('"', out);
+    for (i = 0; i < max && str[i] != '\0'; i++)
+    {
+        switch (str[i])
+        {
+            case '"':
+                fputs("\\\"", out);
+                break;
+            case '\\':
+                fputs("\\\\", out);
+                break;
+            default:
+                if ((unsigned char) str[i] < 0x20)
+                    fprintf(out, "\\u%04x", str[i]);
+                else
+                    fputc(str[i], out);
+        }
+    }
+    fputc('"', out);
+}
+
+static void printEvent(FILE *out, const cpdb_trace_event_t *ev, gint64 origin)
+{
+    fprintf(out, "{\"name\":");
+    printJsonString(out, ev->name, sizeof(ev->name));
+    fprintf(out, ",\"cat\":\"%s\"",
+            ev->type < G_N_ELEMENTS(event_categories) ? event_categories[ev->type] : "unknown");
+    if (ev->duration < 0)
+        fprintf(out, ",\"ph\":\"i\",\"s\":\"t\"");
+    else
+        fprintf(out, ",\"ph\":\"X\",\"dur\":%" G_GINT64_FORMAT, ev->duration);
+    fprintf(out, ",\"ts\":%" G_GINT64_FORMAT ",\"pid\":1,\"tid\":%u",
+            ev->timestamp - origin, ev->thread);
+    fprintf(out, ",\"args\":{\"arg\":");
+    printJsonString(out, ev->arg, sizeof(ev->arg));
+    fprintf(out, ",\"value\":%" G_GINT64_FORMAT ",\"size\":%" G_GINT64_FORMAT "}}",
+            ev->value, ev->size);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *in, *out = stdout;
+    long events_start;
+    guint32 i, num_events;
+    gint64 origin = G_MAXINT64;
+    cpdb_trace_header_t header;
+    cpdb_trace_event_t ev;
+
+    if (argc != 2 && argc != 3)
+    {
+        printf("Usage : %s trace_file [json_file]\n", argv[0]);
+        printf("Converts a trace written with CPDB_TRACE_FILE set "
+               "to the Chrome trace event format\n");
+        exit(EXIT_SUCCESS);
+    }
+
+    if ((in = fopen(argv[1], "rb")) == NULL)
+    {
+        fprintf(stderr, "Couldn't open %s\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    if (fread(&header, sizeof(header), 1, in) != 1 ||
+        memcmp(header.magic, CPDB_TRACE_MAGIC, sizeof(header.magic)) != 0 ||
+        header.version != CPDB_TRACE_VERSION ||
+        header.event_size != sizeof(cpdb_trace_event_t))
+    {
+        fprintf(stderr, "%s isn't a trace file of this CPDB version\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+    if (argc == 3 && (out = fopen(argv[2], "w")) == NULL)
+    {
+        fprintf(stderr, "Couldn't open %s for writing\n", argv[2]);
+        exit(EXIT_FAILURE);
+    }
+    if (header.num_lost)
+        fprintf(stderr, "%" G_GUINT64_FORMAT " older events were overwritten\n",
+                header.num_lost);
+
+    /* Timestamps are made relative to the earliest one, events are
+     * recorded once complete so the first one isn't necessarily it */
+    events_start = ftell(in);
+    for (num_events = 0; num_events < header.num_events; num_events++)
+    {
+        if (fread(&ev, sizeof(ev), 1, in) != 1)
+        {
+            fprintf(stderr, "Trace truncated after %u events\n", num_events);
+            break;
+        }
+        if (ev.timestamp < origin)
+            origin = ev.timestamp;
+    }
+    if (fseek(in, events_start, SEEK_SET) != 0)
+    {
+        fprintf(stderr, "Couldn't read %s again\n", argv[1]);
+        exit(EXIT_FAILURE);
+    }
+
+    fprintf(out, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    for (i = 0; i < num_events && fread(&ev, sizeof(ev), 1, in) == 1; i++)
+    {
+        if (i > 0)
+            fprintf(out, ",\n");
+        printEvent(out, &ev, origin);
+    }
+    fprintf(out, "\n]}\n");
+
+    fclose(in);
+    if (out != stdout)
+        fclose(out);
+    return 0;
+}
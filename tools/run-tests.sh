@@ -72,6 +72,12 @@ sleep 5
   sleep 5; \
   echo get-all-options $QUEUE CUPS; \
   sleep 2; \
+  echo get-options-view $QUEUE CUPS; \
+  sleep 1; \
+  echo validate-settings $QUEUE CUPS; \
+  sleep 1; \
+  echo get-media-for-size 10478 24130 $QUEUE CUPS; \
+  sleep 1; \
   echo print-file $FILE_TO_PRINT $QUEUE CUPS; \
   sleep 1; \
   echo stop \
@@ -108,6 +114,24 @@ fi
 
 echo
 
+# Did the options view list the options too?
+echo "Options listed by get-all-options and get-options-view:"
+if test `grep -c '^Retrieved [0-9]* options\.$' $LOG` -lt 2; then
+    echo "FAIL: Options view not listed!"
+    exit 1
+fi
+
+echo
+
+# Were the settings of the printer validated?
+echo "Validation of the settings:"
+if ! grep '^Found [0-9]* invalid settings\.$' $LOG; then
+    echo "FAIL: Settings not validated!"
+    exit 1
+fi
+
+echo
+
 # Does the setting "na_number-10_4.125x9.5in" appear as a default setting?
 echo "\"na_number-10_4.125x9.5in\" as a default setting:"
 if ! grep 'DEFAULT: *na_number-10_4.125x9.5in' $LOG; then
@@ -117,6 +141,15 @@ fi
 
 echo
 
+# Is an envelope-sized page matched to "na_number-10_4.125x9.5in"?
+echo "Media-size for a page of 104.78x241.3mm:"
+if ! grep '^na_number-10_4.125x9.5in (' $LOG; then
+    echo "FAIL: Page not matched to \"na_number-10_4.125x9.5in\"!"
+    exit 1
+fi
+
+echo
+
 # Did the successful submission of a print job get confirmed?
 echo "Confirmation message for job submission:"
 if ! grep -i 'Document send succeeded' $LOG; then